@@ -0,0 +1,127 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef MYRTTI_APPEND_ARRAY_H
+#define MYRTTI_APPEND_ARRAY_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "utils/span.h"
+
+namespace myrtti {
+
+namespace details {
+    template<typename T>
+    void copy_item(T& dst, const T& src) { dst = src; }
+
+    template<typename T>
+    void copy_item(std::atomic<T>& dst, const std::atomic<T>& src) {
+        dst.store(src.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+/// @brief Array which is only appended to, while readers keep using its
+/// prefix (see view).
+///
+/// Items are never written once they are appended, unless they are
+/// atomic. When capacity is exhausted, items are copied to twice bigger
+/// buffer, and previous buffer is retained if some view refers it. So
+/// appending costs amortized O(1) and retained buffers take no more than
+/// the current one.
+template<typename T>
+struct AppendArray {
+    std::size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+
+    /// @brief Current items, for use by writer. Unlike view, it doesn't
+    /// keep buffer alive once array grows.
+    const T* data() const { return items; }
+
+    T& operator[](std::size_t i) { return items[i]; }
+    const T& operator[](std::size_t i) const { return items[i]; }
+
+    void push_back(const T& v) {
+        reserve(n + 1);
+        details::copy_item(items[n++], v);
+    }
+
+    /// @brief Appends default constructed items.
+    void grow(std::size_t extra) {
+        reserve(n + extra);
+        n += extra;
+    }
+
+    template<typename ItT>
+    void append(ItT first, ItT last) {
+        reserve(n + std::distance(first, last));
+        for (; first != last; ++first)
+            details::copy_item(items[n++], *first);
+    }
+
+    /// @return current items, view stays valid while array is alive.
+    span<const T> view() const {
+        viewed = true;
+        return {items, n};
+    }
+
+    /// @brief Makes room for given amount of items.
+    void reserve(std::size_t size) {
+        if (size <= capacity)
+            return;
+
+        std::size_t prevCapacity = capacity;
+        capacity = std::max({size, capacity * 2, std::size_t(16)});
+        std::unique_ptr<T[]> buffer(new T[capacity]());
+        for (std::size_t i = 0; i != n; ++i)
+            details::copy_item(buffer[i], items[i]);
+
+        if (!viewed && !buffers.empty()) {
+            buffers.pop_back();
+            allocated -= prevCapacity;
+        }
+        viewed = false;
+        allocated += capacity;
+
+        items = buffer.get();
+        buffers.push_back(std::move(buffer));
+    }
+
+    /// @return heap memory taken by current and retained buffers.
+    std::size_t memoryUsage() const {
+        return allocated * sizeof(T) + buffers.capacity() * sizeof(buffers[0]);
+    }
+
+private:
+    T* items = nullptr;
+    std::size_t n = 0;
+    std::size_t capacity = 0;
+
+    /// @brief Total capacity of buffers.
+    std::size_t allocated = 0;
+
+    /// @brief True if some view refers current buffer.
+    mutable bool viewed = false;
+
+    /// @brief Buffers views refer, the last one is current.
+    std::vector<std::unique_ptr<T[]>> buffers;
+};
+
+} // namespace myrtti
+
+#endif
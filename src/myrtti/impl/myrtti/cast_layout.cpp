@@ -0,0 +1,253 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include "myrtti/cast_layout.h"
+#include "myrtti/cast_profile.h"
+
+using namespace std;
+
+namespace myrtti {
+
+namespace {
+    const char* layout_header = "# myrtti cast layout v1";
+
+    /// Amount of seeds we try before doubling slots amount.
+    constexpr unsigned seed_attempts = 1 << 12;
+
+    /// Slots are indexed by uint8_t, so table has at most 2^8 slots.
+    constexpr unsigned max_bits = 8;
+
+    constexpr uint64_t splitmix64(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    bool isPerfect(const vector<class_id_t>& targets, uint64_t seed, unsigned bits) {
+        vector<bool> used(size_t(1) << bits);
+        for (auto t : targets) {
+            auto slot = CastTable::slotOf(t, seed, bits);
+            if (used[slot])
+                return false;
+            used[slot] = true;
+        }
+        return true;
+    }
+
+    /// @brief Checks table size before anything is allocated for it.
+    /// @return amount of targets
+    size_t checked_size(class_id_t cls, size_t targets, unsigned bits) {
+        if (bits == 0 || bits > max_bits || targets >= CastTable::empty_slot) {
+            ostringstream strm;
+            strm << "Cast table for class " << cls << " is too large.";
+            throw runtime_error(strm.str());
+        }
+        return targets;
+    }
+}
+
+CastTable::CastTable(
+    class_id_t cls,
+    const vector<class_id_t>& targets,
+    const vector<uint64_t>& counts,
+    uint64_t seed,
+    unsigned bits
+)
+: cls(cls), seed(seed), bits(bits),
+  numEntries(checked_size(cls, targets.size(), bits)),
+  entries(new entry_t[numEntries]),
+  slots(new uint8_t[size_t(1) << bits])
+{
+    fill(slots.get(), slots.get() + (size_t(1) << bits), empty_slot);
+
+    for (size_t i = 0, e = targets.size(); i != e; ++i) {
+        entries[i].target = targets[i];
+        entries[i].count = counts[i];
+
+        auto slot = slotOf(targets[i], seed, bits);
+        if (slots[slot] != empty_slot) {
+            ostringstream strm;
+            strm << "Cast table for class " << cls << " has colliding slots,"
+                 << " seed " << hex << seed << " is not suitable.";
+            throw runtime_error(strm.str());
+        }
+        slots[slot] = static_cast<uint8_t>(i);
+    }
+}
+
+void CastTable::pickSeed(const vector<class_id_t>& targets, uint64_t& seed, unsigned& bits) {
+    // Start with load factor 0.5 or less, and grow table whenever
+    // we fail to find perfect seed.
+    bits = 1;
+    while ((size_t(1) << bits) < targets.size() * 2)
+        ++bits;
+
+    for (; bits <= max_bits; ++bits) {
+        for (unsigned attempt = 0; attempt != seed_attempts; ++attempt) {
+            seed = splitmix64(attempt);
+            if (isPerfect(targets, seed, bits))
+                return;
+        }
+    }
+
+    throw runtime_error("Unable to find perfect hash seed for cast table.");
+}
+
+shared_ptr<CastLayout> CastLayout::build(const CastProfile& profile) {
+    // Entries are already sorted hottest first, so we only group them
+    // by source class. Keep groups ordered by id to make output stable.
+    map<class_id_t, vector<CastProfile::entry_t>> groups;
+    for (auto& e : profile.entries()) {
+        auto& group = groups[e.from];
+        if (group.size() < max_targets)
+            group.push_back(std::move(e));
+    }
+
+    auto layout = make_shared<CastLayout>();
+
+    for (const auto& [cls, group] : groups) {
+        vector<class_id_t> targets;
+        vector<uint64_t> counts;
+        for (const auto& e : group) {
+            targets.push_back(e.to);
+            counts.push_back(e.count);
+        }
+
+        uint64_t seed;
+        unsigned bits;
+        CastTable::pickSeed(targets, seed, bits);
+
+        layout->addTable(make_unique<CastTable>(cls, targets, counts, seed, bits));
+    }
+
+    return layout;
+}
+
+shared_ptr<CastLayout> CastLayout::load(istream& s) {
+    auto layout = make_shared<CastLayout>();
+
+    string line;
+    size_t lineNo = 0;
+
+    auto malformed = [&] {
+        ostringstream strm;
+        strm << "Malformed cast layout, line " << lineNo << ": " << line;
+        throw runtime_error(strm.str());
+    };
+
+    auto nextLine = [&] {
+        while (getline(s, line)) {
+            ++lineNo;
+            if (!line.empty() && line[0] != '#')
+                return true;
+        }
+        return false;
+    };
+
+    while (nextLine()) {
+        istringstream ls(line);
+
+        string tag;
+        class_id_t cls("");
+        uint64_t seed;
+        unsigned bits;
+        size_t n;
+        ls >> tag >> hex >> cls.value >> seed >> dec >> bits >> n;
+        if (ls.fail() || tag != "class" || n > max_targets)
+            malformed();
+        if (bits == 0 || bits > max_bits)
+            malformed();
+
+        vector<class_id_t> targets;
+        vector<uint64_t> counts;
+        for (size_t i = 0; i != n; ++i) {
+            if (!nextLine())
+                malformed();
+
+            istringstream ts(line);
+            class_id_t target("");
+            uint64_t count;
+            ts >> hex >> target.value >> dec >> count;
+            if (ts.fail())
+                malformed();
+
+            targets.push_back(target);
+            counts.push_back(count);
+        }
+
+        layout->addTable(make_unique<CastTable>(cls, targets, counts, seed, bits));
+    }
+
+    return layout;
+}
+
+void CastLayout::save(ostream& s) const {
+    s << layout_header << "\n";
+    for (const auto& table : tables) {
+        s << "class " << hex << table->getId().value << " " << table->getSeed()
+          << " " << dec << table->getBits() << " " << table->size() << "\n";
+
+        for (size_t i = 0, e = table->size(); i != e; ++i) {
+            const auto& entry = (*table)[i];
+            s << "    " << hex << entry.target.value << " " << dec << entry.count << "\n";
+        }
+    }
+}
+
+void CastLayout::emitHeader(ostream& s) const {
+    s << "// Generated by myrtti_profdata, do not edit.\n"
+      << "// Include it into exactly one translation unit.\n"
+      << "\n"
+      << "#include <sstream>\n"
+      << "\n"
+      << "#include \"myrtti/cast_layout.h\"\n"
+      << "#include \"myrtti/hierarchy.h\"\n"
+      << "\n"
+      << "namespace {\n"
+      << "    const bool myrttiCastLayoutApplied = [] {\n"
+      << "        std::istringstream s(R\"myrtti(\n";
+    save(s);
+    s << ")myrtti\");\n"
+      << "        myrtti::Hierarchy::instance()->setCastLayout(\n"
+      << "            myrtti::CastLayout::load(s)\n"
+      << "        );\n"
+      << "        return true;\n"
+      << "    }();\n"
+      << "}\n";
+}
+
+const CastTable* CastLayout::find(class_id_t cls) const {
+    auto found = index.find(cls);
+    if (found != end(index))
+        return found->second;
+    return nullptr;
+}
+
+void CastLayout::addTable(unique_ptr<CastTable> table) {
+    auto [_, inserted] = index.emplace(table->getId(), table.get());
+    if (!inserted) {
+        ostringstream strm;
+        strm << "Cast layout contains duplicated table for class " << table->getId();
+        throw runtime_error(strm.str());
+    }
+    tables.push_back(std::move(table));
+}
+
+} // namespace myrtti
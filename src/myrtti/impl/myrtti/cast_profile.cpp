@@ -0,0 +1,184 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "myrtti/cast_profile.h"
+#include "myrtti/class_info.h"
+
+using namespace std;
+
+namespace myrtti {
+
+namespace {
+    struct edge_t {
+        class_id_t from;
+        class_id_t to;
+
+        bool operator==(const edge_t& rhs) const {
+            return from == rhs.from && to == rhs.to;
+        }
+    };
+
+    struct edge_hash_t {
+        size_t operator()(const edge_t& e) const {
+            return e.from.value ^ (e.to.value * 0x9e3779b97f4a7c15ull);
+        }
+    };
+
+    const char* profile_header = "# myrtti cast profile v1";
+
+    atomic<uint64_t> nextSerial{1};
+}
+
+struct CastProfile::shard_t {
+    mutex lock;
+    unordered_map<edge_t, uint64_t, edge_hash_t> counters;
+    unordered_map<class_id_t, string> names;
+
+    void add(class_id_t from, class_id_t to, uint64_t count) {
+        counters[{from, to}] += count;
+    }
+};
+
+CastProfile::CastProfile() : serial(nextSerial++) {}
+CastProfile::~CastProfile() = default;
+
+CastProfile::shard_t* CastProfile::threadShard() {
+    // Each thread caches shard of the last profile it has recorded to.
+    thread_local uint64_t cachedSerial = 0;
+    thread_local shard_t* cachedShard = nullptr;
+
+    if (cachedSerial == serial)
+        return cachedShard;
+
+    lock_guard<mutex> guard(shardsLock);
+    shards.push_back(make_unique<shard_t>());
+    cachedSerial = serial;
+    cachedShard = shards.back().get();
+    return cachedShard;
+}
+
+void CastProfile::record(const ClassInfo* from, const ClassInfo* to) {
+    shard_t* shard = threadShard();
+    lock_guard<mutex> guard(shard->lock);
+
+    auto& count = shard->counters[{from->getId(), to->getId()}];
+    if (count++ == 0) {
+        shard->names.emplace(from->getId(), from->name);
+        shard->names.emplace(to->getId(), to->name);
+    }
+}
+
+void CastProfile::add(const entry_t& entry) {
+    shard_t* shard = threadShard();
+    lock_guard<mutex> guard(shard->lock);
+
+    shard->add(entry.from, entry.to, entry.count);
+    shard->names.emplace(entry.from, entry.fromName);
+    shard->names.emplace(entry.to, entry.toName);
+}
+
+void CastProfile::merge(const CastProfile& src) {
+    for (const auto& e : src.entries())
+        add(e);
+}
+
+vector<CastProfile::entry_t> CastProfile::entries() const {
+    shard_t merged;
+    {
+        lock_guard<mutex> guard(shardsLock);
+        for (const auto& shard : shards) {
+            lock_guard<mutex> shardGuard(shard->lock);
+            for (const auto& [edge, count] : shard->counters)
+                merged.add(edge.from, edge.to, count);
+            merged.names.insert(begin(shard->names), end(shard->names));
+        }
+    }
+
+    vector<entry_t> res;
+    res.reserve(merged.counters.size());
+    for (const auto& [edge, count] : merged.counters) {
+        res.push_back({
+            edge.from, edge.to, count,
+            merged.names[edge.from], merged.names[edge.to]
+        });
+    }
+
+    // Hottest first, ties are resolved by ids to keep output stable.
+    sort(begin(res), end(res), [](const entry_t& l, const entry_t& r) {
+        if (l.count != r.count)
+            return l.count > r.count;
+        if (l.from != r.from)
+            return l.from < r.from;
+        return l.to < r.to;
+    });
+
+    return res;
+}
+
+void CastProfile::save(ostream& s) const {
+    s << profile_header << "\n";
+    for (const auto& e : entries()) {
+        s << hex << e.from.value << " " << e.to.value << " "
+          << dec << e.count << " "
+          << e.fromName << " " << e.toName << "\n";
+    }
+}
+
+void CastProfile::load(istream& s) {
+    string line;
+    size_t lineNo = 0;
+    while (getline(s, line)) {
+        ++lineNo;
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        istringstream ls(line);
+        entry_t e{class_id_t(""), class_id_t(""), 0, "", ""};
+        ls >> hex >> e.from.value >> e.to.value >> dec >> e.count
+           >> e.fromName >> e.toName;
+
+        if (ls.fail()) {
+            ostringstream strm;
+            strm << "Malformed cast profile, line " << lineNo << ": " << line;
+            throw runtime_error(strm.str());
+        }
+        add(e);
+    }
+}
+
+namespace {
+    /// @brief Process wide profile, saves itself on exit.
+    struct ProcessCastProfile : CastProfile {
+        ~ProcessCastProfile() {
+            const char* path = getenv("MYRTTI_PROFILE_FILE");
+            ofstream out(path ? path : "myrtti.profile");
+            save(out);
+        }
+    };
+}
+
+CastProfile* CastProfile::instance() {
+    static ProcessCastProfile profile;
+    return &profile;
+}
+
+} // namespace myrtti
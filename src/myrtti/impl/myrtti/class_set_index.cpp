@@ -0,0 +1,100 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "myrtti/class_set_index.h"
+
+using namespace std;
+
+namespace myrtti {
+
+namespace {
+    /// Minimal amount of memo entries, so first few classes asked for
+    /// don't cause chain of reallocations.
+    constexpr uint32_t min_memo_size = 64;
+}
+
+struct ClassSetIndex::Impl {
+    unordered_map<class_id_t, uint32_t> positions;
+
+    /// @brief Serializes memo growth.
+    mutex growLock;
+
+    /// @brief All memos ever published, the last one is current. Older
+    /// ones may still be read by concurrent lookups, so they are retired
+    /// along with index.
+    vector<unique_ptr<Memo>> memos;
+};
+
+ClassSetIndex::ClassSetIndex(span<const class_id_t> members)
+: impl(make_unique<Impl>())
+{
+    for (uint32_t i = 0; i != members.size(); ++i)
+        impl->positions.emplace(members[i], i);
+
+    impl->memos.push_back(make_unique<Memo>(Memo{0, nullptr}));
+    memo.store(impl->memos.back().get(), memory_order_release);
+}
+
+ClassSetIndex::~ClassSetIndex() = default;
+
+uint32_t ClassSetIndex::position(class_id_t id) const {
+    auto found = impl->positions.find(id);
+    return found != end(impl->positions) ? found->second : npos;
+}
+
+uint32_t ClassSetIndex::findSlow(const ClassInfo* cls) const {
+    uint32_t pos = npos;
+    for (const ClassInfo* c : unwind_order(cls)) {
+        pos = position(c->getId());
+        if (pos != npos)
+            break;
+    }
+
+    uint32_t i = cls->getIndex();
+    auto* m = memo.load(memory_order_acquire);
+
+    if (i >= m->size) {
+        lock_guard lock(impl->growLock);
+
+        m = memo.load(memory_order_relaxed);
+        if (i >= m->size) {
+            uint32_t size = max({i + 1, m->size * 2, min_memo_size});
+
+            auto grown = make_unique<Memo>(
+                Memo{size, make_unique<atomic<uint32_t>[]>(size)}
+            );
+            for (uint32_t j = 0; j != m->size; ++j)
+                grown->entries[j].store(m->entries[j].load(memory_order_relaxed), memory_order_relaxed);
+            for (uint32_t j = m->size; j != size; ++j)
+                grown->entries[j].store(unknown, memory_order_relaxed);
+
+            // Answers stored to old memo after copy are lost, they will
+            // be just computed once again.
+            m = grown.get();
+            impl->memos.push_back(std::move(grown));
+            memo.store(m, memory_order_release);
+        }
+    }
+
+    m->entries[i].store(pos, memory_order_relaxed);
+    return pos;
+}
+
+} // namespace myrtti
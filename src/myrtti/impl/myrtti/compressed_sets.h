@@ -0,0 +1,222 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRTTI_COMPRESSED_SETS_H
+#define MYRTTI_COMPRESSED_SETS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+
+#include "utils/bits.h"
+#include "utils/memory_usage.h"
+#include "utils/span.h"
+
+#include "append_array.h"
+
+namespace myrtti {
+
+/// @brief Family of compressed sets of 32-bit values (roaring-style).
+///
+/// Values of set are split by high 16 bits into containers. Container
+/// stores low 16 bits either as sorted array, or as bitmap if it is
+/// more compact (more than 4096 values). So membership test is a binary
+/// search among few containers, and then either binary search in array
+/// or single bit test.
+///
+/// All sets live in three flat arrays, so they could be stored in
+/// binary image as is.
+struct compressed_sets_t {
+
+    struct container_t {
+        uint16_t key;
+        uint16_t kind;
+        uint32_t size;
+
+        /// @brief Offset of container data in pool.
+        uint32_t offset;
+    };
+
+    static constexpr uint16_t kind_array = 0;
+    static constexpr uint16_t kind_bitmap = 1;
+
+    static constexpr uint32_t max_array_size = 4096;
+    static constexpr uint32_t bitmap_words = 65536 / 16;
+
+    /// @brief Containers of set i are containers[setsBegin[i] .. setsBegin[i + 1]).
+    span<const uint32_t> setsBegin;
+    span<const container_t> containers;
+    span<const uint16_t> pool;
+
+    bool contains(uint32_t set, uint32_t value) const {
+        uint16_t key = value >> 16;
+        uint16_t low = value & 0xffff;
+
+        const container_t* first = containers.data() + setsBegin[set];
+        const container_t* last = containers.data() + setsBegin[set + 1];
+        const container_t* c = std::lower_bound(
+            first, last, key,
+            [](const container_t& c, uint16_t key) { return c.key < key; }
+        );
+        if (c == last || c->key != key)
+            return false;
+
+        const uint16_t* data = pool.data() + c->offset;
+        if (c->kind == kind_bitmap)
+            return (data[low / 16] >> (low % 16)) & 1;
+        return std::binary_search(data, data + c->size, low);
+    }
+
+    /// @brief Calls fn for each value of set, in ascending order.
+    template<typename FnT>
+    void forEach(uint32_t set, FnT&& fn) const {
+        for (uint32_t k = setsBegin[set]; k != setsBegin[set + 1]; ++k) {
+            const container_t& c = containers[k];
+            uint32_t high = uint32_t(c.key) << 16;
+            const uint16_t* data = pool.data() + c.offset;
+
+            if (c.kind == kind_bitmap) {
+                for (uint32_t w = 0; w != bitmap_words; ++w) {
+                    for (uint32_t bits = data[w]; bits; bits &= bits - 1)
+                        fn(high | (w * 16 + countr_zero(bits)));
+                }
+            } else {
+                for (uint32_t i = 0; i != c.size; ++i)
+                    fn(high | data[i]);
+            }
+        }
+    }
+
+    /// @return amount of values in set.
+    std::size_t size(uint32_t set) const {
+        std::size_t res = 0;
+        for (uint32_t k = setsBegin[set]; k != setsBegin[set + 1]; ++k)
+            res += containers[k].size;
+        return res;
+    }
+};
+
+/// @brief Builds compressed_sets_t, sets with the same values are stored
+/// once.
+///
+/// Sets are only appended, so views taken before (see view) remain valid
+/// while builder is alive, and builder may keep adding sets while they
+/// are read.
+struct CompressedSetsBuilder {
+    using container_t = compressed_sets_t::container_t;
+
+    AppendArray<uint32_t> setsBegin;
+    AppendArray<container_t> containers;
+    AppendArray<uint16_t> pool;
+
+    CompressedSetsBuilder() {
+        setsBegin.push_back(0);
+    }
+
+    /// @brief Continues given sets. New sets are deduplicated among
+    /// themselves only.
+    explicit CompressedSetsBuilder(const compressed_sets_t& base) {
+        setsBegin.append(begin(base.setsBegin), end(base.setsBegin));
+        containers.append(begin(base.containers), end(base.containers));
+        pool.append(begin(base.pool), end(base.pool));
+    }
+
+    CompressedSetsBuilder(const CompressedSetsBuilder&) = delete;
+    CompressedSetsBuilder& operator=(const CompressedSetsBuilder&) = delete;
+
+    /// @brief Adds set.
+    /// @param values sorted unique values
+    /// @return set id
+    uint32_t add(span<const uint32_t> values) {
+        uint64_t hash = hashOf(values);
+
+        auto range = known.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (equals(it->second, values))
+                return it->second;
+        }
+
+        uint32_t set = setsBegin.size() - 1;
+
+        for (std::size_t i = 0; i != values.size();) {
+            uint16_t key = values[i] >> 16;
+            std::size_t e = i;
+            while (e != values.size() && (values[e] >> 16) == key)
+                ++e;
+
+            container_t c{key, compressed_sets_t::kind_array, uint32_t(e - i), uint32_t(pool.size())};
+            if (c.size > compressed_sets_t::max_array_size) {
+                c.kind = compressed_sets_t::kind_bitmap;
+                pool.grow(compressed_sets_t::bitmap_words);
+                for (; i != e; ++i) {
+                    uint16_t low = values[i] & 0xffff;
+                    pool[c.offset + low / 16] |= uint16_t(1) << (low % 16);
+                }
+            } else {
+                for (; i != e; ++i)
+                    pool.push_back(values[i] & 0xffff);
+            }
+            containers.push_back(c);
+        }
+        setsBegin.push_back(containers.size());
+
+        known.emplace(hash, set);
+        return set;
+    }
+
+    /// @return sets, which stay valid while builder is alive.
+    compressed_sets_t view() const {
+        return {setsBegin.view(), containers.view(), pool.view()};
+    }
+
+    /// @return sets for immediate use, they are invalidated by next add.
+    compressed_sets_t current() const {
+        return {
+            {setsBegin.data(), setsBegin.size()},
+            {containers.data(), containers.size()},
+            {pool.data(), pool.size()}
+        };
+    }
+
+    /// @return heap memory taken by builder, including buffers retained
+    ///         for views.
+    std::size_t memoryUsage() const {
+        return setsBegin.memoryUsage() + containers.memoryUsage() + pool.memoryUsage()
+            + node_container_bytes(known);
+    }
+
+private:
+    static uint64_t hashOf(span<const uint32_t> values) {
+        uint64_t h = 0xcbf29ce484222325ull;
+        for (uint32_t v : values)
+            h = (h ^ v) * 0x100000001b3ull;
+        return h ^ values.size();
+    }
+
+    bool equals(uint32_t set, span<const uint32_t> values) const {
+        auto sets = current();
+        if (sets.size(set) != values.size())
+            return false;
+        std::size_t i = 0;
+        bool same = true;
+        sets.forEach(set, [&](uint32_t v) { same = same && values[i++] == v; });
+        return same;
+    }
+
+    std::unordered_multimap<uint64_t, uint32_t> known;
+};
+
+} // namespace myrtti
+
+#endif
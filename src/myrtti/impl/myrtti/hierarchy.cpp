@@ -12,11 +12,916 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
 #include "myrtti/hierarchy.h"
+#include "myrtti/cast_layout.h"
 #include "myrtti/class_info.h"
+#include "myrtti/dag.h"
+#include "myrtti/runtime.h"
+#include "utils/memory_usage.h"
+
+#include "hierarchy_snapshot.h"
+
+#ifdef MYRTTI_CLASS_SECTION
+#include <link.h>
+#endif
 
 namespace myrtti {
-    class_id_t Hierarchy::resolveClassInfoId(const ClassInfo* classInfo) {
-        return classInfo->getId();
+    namespace {
+        //
+        // Epoch based reclamation.
+        //
+        // Each thread which runs read queries owns a record, where it
+        // announces epoch its outermost query has started in (0 if there
+        // is no query running). Records are never freed, and are reused
+        // once their threads exit.
+        //
+        // Reclaiming side retires memory, advances epoch, and either
+        // waits until each record is either idle or has newer epoch, or
+        // keeps memory until it finds out so.
+
+        std::atomic<uint64_t> global_epoch{1};
+
+        struct ReaderRecord {
+            std::atomic<uint64_t> epoch{0};
+            std::atomic<bool> taken{true};
+            ReaderRecord* next = nullptr;
+        };
+
+        std::atomic<ReaderRecord*> reader_records{nullptr};
+
+        ReaderRecord* acquire_reader_record() {
+            for (ReaderRecord* r = reader_records.load(std::memory_order_acquire); r; r = r->next) {
+                bool taken = false;
+                if (!r->taken.load(std::memory_order_relaxed)
+                    && r->taken.compare_exchange_strong(taken, true, std::memory_order_acquire))
+                    return r;
+            }
+
+            auto* r = new ReaderRecord();
+            r->next = reader_records.load(std::memory_order_relaxed);
+            while (!reader_records.compare_exchange_weak(
+                r->next, r, std::memory_order_release, std::memory_order_relaxed))
+                ;
+            return r;
+        }
+
+        struct ThreadReader {
+            ReaderRecord* record = acquire_reader_record();
+
+            /// @brief Nesting of read queries.
+            unsigned depth = 0;
+
+            ~ThreadReader() {
+                record->taken.store(false, std::memory_order_release);
+            }
+        };
+
+        thread_local ThreadReader thread_reader;
+
+        /// @brief Announces read query of current thread, nested ones
+        /// keep epoch of outermost query.
+        void enter_read() {
+            if (!thread_reader.depth++) {
+                thread_reader.record->epoch.store(
+                    global_epoch.load(std::memory_order_seq_cst),
+                    std::memory_order_seq_cst
+                );
+            }
+        }
+
+        void leave_read() {
+            if (!--thread_reader.depth)
+                thread_reader.record->epoch.store(0, std::memory_order_release);
+        }
+
+        /// @brief Marks read query, memory retired while it is running is
+        /// not reclaimed.
+        struct ReadGuard {
+            ReadGuard() { enter_read(); }
+            ~ReadGuard() { leave_read(); }
+        };
+
+        /// @brief Advances epoch. Memory retired before call may be
+        /// reclaimed once readers_passed(returned epoch).
+        uint64_t advance_epoch() {
+            return global_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+        }
+
+        /// @return true if all read queries started before given epoch
+        ///         are finished. Doesn't wait.
+        bool readers_passed(uint64_t epoch) {
+            for (ReaderRecord* r = reader_records.load(std::memory_order_acquire); r; r = r->next) {
+                uint64_t e = r->epoch.load(std::memory_order_seq_cst);
+                if (e != 0 && e < epoch)
+                    return false;
+            }
+            return true;
+        }
+
+        /// @brief Waits until all read queries started before call are
+        /// finished.
+        void synchronize() {
+            uint64_t epoch = advance_epoch();
+            while (!readers_passed(epoch))
+                std::this_thread::yield();
+        }
+
+        thread_local Hierarchy::Module* registering_module = nullptr;
+
+        /// @brief Class defined by Hierarchy::defineClass, with storage
+        /// for its name and parents.
+        struct DefinedClass {
+            DefinedClass(const std::string& name, span<const ClassInfo* const> parentClasses)
+            : name(name), parents(begin(parentClasses), end(parentClasses)),
+              parentIds(collectIds(parents)),
+              info(
+                  this->name.c_str(), class_id_t(this->name.c_str()),
+                  parentIds.data(), parents.data(), parents.size()
+              )
+            {}
+
+            std::string name;
+            std::vector<const ClassInfo*> parents;
+            std::vector<class_id_t> parentIds;
+            ClassInfo info;
+
+        private:
+            static std::vector<class_id_t> collectIds(const std::vector<const ClassInfo*>& parents) {
+                std::vector<class_id_t> ids;
+                ids.reserve(parents.size());
+                for (const ClassInfo* p : parents)
+                    ids.push_back(p->getId());
+                return ids;
+            }
+        };
+
+#ifdef MYRTTI_CLASS_SECTION
+        //
+        // Class sections of loaded modules, see details::section_entry.
+        //
+
+        constexpr ElfW(Word) section_note_type = 1;
+        constexpr char section_note_name[] = "myrtti";
+
+        struct section_scan_t {
+            /// @brief Loaded modules counter (dlpi_adds) as of previous
+            /// scan, modules are scanned again only if it has changed.
+            unsigned long long adds = 0;
+            bool first = true;
+            std::vector<const ClassInfo*> classes;
+        };
+
+        /// @brief dl_iterate_phdr callback, collects classes of section
+        /// noted in program headers of module.
+        int collect_section_classes(dl_phdr_info* info, std::size_t size, void* data) {
+            auto& scan = *static_cast<section_scan_t*>(data);
+            if (std::exchange(scan.first, false)
+                && size >= offsetof(dl_phdr_info, dlpi_adds) + sizeof(info->dlpi_adds)) {
+                if (info->dlpi_adds == scan.adds)
+                    return 1;
+                scan.adds = info->dlpi_adds;
+            }
+
+            for (std::size_t i = 0; i != info->dlpi_phnum; ++i) {
+                const ElfW(Phdr)& segment = info->dlpi_phdr[i];
+                if (segment.p_type != PT_NOTE)
+                    continue;
+
+                std::size_t align = segment.p_align == 8 ? 8 : 4;
+                auto padded = [&](std::size_t n) { return (n + align - 1) & ~(align - 1); };
+
+                const char* note = reinterpret_cast<const char*>(info->dlpi_addr + segment.p_vaddr);
+                const char* end = note + segment.p_memsz;
+                while (note + sizeof(ElfW(Nhdr)) <= end) {
+                    ElfW(Nhdr) header;
+                    std::memcpy(&header, note, sizeof(header));
+                    const char* name = note + sizeof(header);
+                    const char* desc = name + padded(header.n_namesz);
+                    note = desc + padded(header.n_descsz);
+
+                    if (header.n_type != section_note_type
+                        || header.n_namesz != sizeof(section_note_name)
+                        || std::memcmp(name, section_note_name, sizeof(section_note_name)) != 0
+                        || header.n_descsz != 2 * sizeof(int32_t))
+                        continue;
+
+                    // Section bounds are relative to descriptor.
+                    int32_t bounds[2];
+                    std::memcpy(bounds, desc, sizeof(bounds));
+                    auto* getter = reinterpret_cast<const ClassInfo::info_getter_t*>(desc + bounds[0]);
+                    auto* last = reinterpret_cast<const ClassInfo::info_getter_t*>(desc + bounds[1]);
+                    for (; getter != last; ++getter)
+                        scan.classes.push_back((*getter)());
+                }
+            }
+            return 0;
+        }
+#endif
+    }
+
+    struct Hierarchy::Impl {
+        using classes_map_t = std::unordered_map<class_id_t, const ClassInfo*>;
+
+        Impl(
+            std::atomic<const Snapshot*>& snapshot,
+            std::atomic<bool>& freezePending,
+            std::atomic<bool>& sectionsScanned
+        )
+        : snapshot(snapshot), freezePending(freezePending), sectionsScanned(sectionsScanned) {}
+
+        /// @brief Implementation of add, writer lock should be held.
+        void addLocked(const ClassInfo *cls);
+
+        /// @brief Adds classes of sections of modules loaded since
+        /// previous call, writer lock should be held.
+        void addSections();
+
+        /// @brief Linearizations of class added by current batch, unlike
+        /// windup_order and unwind_order, they don't require class to be
+        /// registered already.
+        static span<const ClassInfo* const> windupOf(const ClassInfo* cls) {
+            return {cls->windupOrder, cls->orderSize};
+        }
+        static span<const ClassInfo* const> unwindOf(const ClassInfo* cls) {
+            return {cls->unwindOrder, cls->orderSize};
+        }
+
+        /// @brief Publishes snapshot of registered classes, writer lock
+        /// should be held. Replaced snapshot is retired.
+        void publish();
+
+        /// @brief Releases retired snapshots no reader uses anymore.
+        void reclaim();
+
+        /// @brief Computes windup and unwind orders of class, its parents
+        /// should have them computed already.
+        void linearize(const ClassInfo *cls);
+
+        /// @brief Links class into node based containers.
+        void link(const ClassInfo *cls);
+
+        /// @brief Releases node based containers, writer lock should be held.
+        void freezeLocked();
+
+        /// @brief Restores node based containers, writer lock should be held.
+        void thaw();
+
+        /// @brief Sets cast table from current layout to given class.
+        void attachCastTable(const ClassInfo* cls);
+
+        std::mutex writeLock;
+
+        /// @brief All registered classes, by dense index. Parents always go
+        /// before their children. Removed classes leave nullptr.
+        std::vector<const ClassInfo*> classes;
+
+        /// @brief Storage for classes linearizations (see windup_order).
+        std::vector<std::unique_ptr<const ClassInfo*[]>> linearizations;
+
+        // Node based containers, released by freeze, which in turn might be
+        // triggered by read query.
+        DAG<class_id_t> dag;
+        classes_map_t idToClass;
+        bool frozen = false;
+        bool autoFreeze = false;
+
+        /// @brief Binary image of registry, see loadImage.
+        std::shared_ptr<const HierarchyImage> image;
+
+        std::shared_ptr<const CastLayout> castLayout;
+
+        /// @brief Snapshot readers currently load.
+        std::unique_ptr<const Snapshot> current;
+
+        /// @brief Replaced snapshot, readers which have started before
+        /// epoch might still use it.
+        struct retired_t {
+            uint64_t epoch;
+            std::unique_ptr<const Snapshot> snapshot;
+
+            /// @brief Descendants lists replaced by the next snapshot.
+            std::vector<std::unique_ptr<Snapshot::Descendants::list_t>> lists;
+        };
+
+        /// @brief Replaced snapshots, oldest first.
+        std::vector<retired_t> retired;
+
+        /// @brief Tables computed snapshots are views of, created by first
+        /// computed snapshot. Retained until some class is removed.
+        std::unique_ptr<Snapshot::Tables> tables;
+
+        /// @brief Descendants lists all snapshots are views of, rebuilt
+        /// once some class is removed.
+        std::unique_ptr<Snapshot::Descendants> descendants = std::make_unique<Snapshot::Descendants>();
+
+        /// @brief Classes created by defineClass.
+        std::unordered_map<const ClassInfo*, std::unique_ptr<DefinedClass>> defined;
+
+        /// @brief Bumped by each publication.
+        uint64_t generation = 0;
+
+        /// @brief Classes added since last publication, they become
+        /// registered once queries see them.
+        std::vector<const ClassInfo*> added;
+
+        /// @brief Hierarchy::snapshot.
+        std::atomic<const Snapshot*>& snapshot;
+
+        /// @brief Hierarchy::freezePending.
+        std::atomic<bool>& freezePending;
+
+        /// @brief Loaded modules counter as of the last addSections.
+        unsigned long long sectionAdds = 0;
+
+        /// @brief Hierarchy::sectionsScanned.
+        std::atomic<bool>& sectionsScanned;
+    };
+
+    namespace details {
+        void register_class(const ClassInfo* cls) {
+            Hierarchy::instance()->add(cls);
+        }
+
+    }
+
+    Hierarchy::ModuleScope::ModuleScope(Module& module) {
+        // Classes of modules loaded before don't go to scope.
+        Hierarchy::instance()->scanSections();
+        prev = std::exchange(registering_module, &module);
+    }
+
+    Hierarchy::ModuleScope::~ModuleScope() {
+        // Sections of modules loaded within scope are registered by now
+        // at the latest.
+        Hierarchy::instance()->scanSections();
+        registering_module = prev;
+    }
+
+    Hierarchy::Hierarchy() : impl(std::make_unique<Impl>(snapshot, freezePending, sectionsScanned)) {
+        if (const char* path = std::getenv("MYRTTI_HIERARCHY_IMAGE")) {
+            // Classes matching image are registered without node based
+            // containers, as if hierarchy was frozen.
+            impl->image = HierarchyImage::map(path);
+            impl->frozen = bool(impl->image);
+        }
+
+        // Readers always have a snapshot to load.
+        std::lock_guard<std::mutex> guard(impl->writeLock);
+        impl->publish();
+    }
+
+    Hierarchy::~Hierarchy() = default;
+
+    const Hierarchy::Snapshot* Hierarchy::view() const {
+        // Should be called within ReadGuard, seq_cst orders it after
+        // epoch announcement.
+        assert(thread_reader.depth);
+#ifdef MYRTTI_CLASS_SECTION
+        if (/* [[unlikely]] */ !sectionsScanned.load(std::memory_order_acquire))
+            scanSections();
+#endif
+        if (/* [[unlikely]] */ freezePending.load(std::memory_order_relaxed))
+            freezeOnQuery();
+        return snapshot.load(std::memory_order_seq_cst);
+    }
+
+    void Hierarchy::scanSections() const {
+        std::lock_guard<std::mutex> guard(impl->writeLock);
+        impl->addSections();
+        if (!impl->added.empty())
+            impl->publish();
+    }
+
+    void Hierarchy::Impl::addSections() {
+#ifdef MYRTTI_CLASS_SECTION
+        section_scan_t scan;
+        scan.adds = sectionAdds;
+        dl_iterate_phdr(collect_section_classes, &scan);
+        sectionAdds = scan.adds;
+
+        for (const ClassInfo* cls : scan.classes)
+            addLocked(cls);
+        sectionsScanned.store(true, std::memory_order_release);
+#endif
+    }
+
+    void Hierarchy::freezeOnQuery() const {
+        // Queries never wait: if writer is busy, the next query will try.
+        std::unique_lock<std::mutex> lock(impl->writeLock, std::try_to_lock);
+        if (lock.owns_lock() && freezePending.exchange(false, std::memory_order_relaxed))
+            impl->freezeLocked();
+    }
+
+    void Hierarchy::Impl::publish() {
+        // While registered classes match image, snapshot covers its
+        // prefix. Otherwise classes registered since previous snapshot
+        // are appended to shared tables, so startup of each module, or
+        // definition of class at run time, costs in proportion to new
+        // classes.
+        std::unique_ptr<Snapshot> fresh;
+        if (image) {
+            fresh = std::make_unique<Snapshot>(++generation, classes, image, *descendants);
+        } else {
+            if (!tables)
+                tables = std::make_unique<Snapshot::Tables>(current.get());
+            fresh = std::make_unique<Snapshot>(++generation, classes, *tables, *descendants);
+        }
+
+        snapshot.store(fresh.get(), std::memory_order_seq_cst);
+        if (current)
+            retired.push_back({advance_epoch(), std::move(current), descendants->takeReplaced()});
+        current = std::move(fresh);
+
+        // Thread which finds class registered may query hierarchy about
+        // it right away.
+        for (const ClassInfo* cls : added)
+            cls->registered.store(true, std::memory_order_release);
+        added.clear();
+
+        // Queries freeze registry once it is published, see setAutoFreeze.
+        if (autoFreeze && !frozen)
+            freezePending.store(true, std::memory_order_relaxed);
+
+        reclaim();
+    }
+
+    void Hierarchy::Impl::reclaim() {
+        // Snapshots are retired in epochs order, so the first one which
+        // is still in use keeps the rest.
+        std::size_t n = 0;
+        while (n != retired.size() && readers_passed(retired[n].epoch))
+            ++n;
+        retired.erase(begin(retired), begin(retired) + n);
+    }
+
+    void Hierarchy::add(const ClassInfo *cls) {
+        // Fast path: class registered before, no need to lock.
+        if (cls->registered.load(std::memory_order_acquire))
+            return;
+
+        std::lock_guard<std::mutex> guard(impl->writeLock);
+        impl->addSections();
+        impl->addLocked(cls);
+        if (!impl->added.empty())
+            impl->publish();
+    }
+
+    void Hierarchy::add(span<const ClassInfo* const> classes) {
+        std::lock_guard<std::mutex> guard(impl->writeLock);
+        impl->addSections();
+        for (const ClassInfo* cls : classes)
+            impl->addLocked(cls);
+        if (!impl->added.empty())
+            impl->publish();
+    }
+
+    const ClassInfo* Hierarchy::defineClass(
+        const std::string& name,
+        span<const ClassInfo* const> parents
+    ) {
+        auto cls = std::make_unique<DefinedClass>(name, parents);
+
+        std::lock_guard<std::mutex> guard(impl->writeLock);
+        impl->addLocked(&cls->info);
+        impl->publish();
+
+        const ClassInfo* info = &cls->info;
+        impl->defined.emplace(info, std::move(cls));
+        return info;
+    }
+
+    void Hierarchy::Impl::addLocked(const ClassInfo *cls) {
+        // Class added by the same batch is published by its end.
+        if (cls->registered.load(std::memory_order_relaxed)
+            || (cls->index < classes.size() && classes[cls->index] == cls))
+            return;
+
+        for (std::size_t i = 0; i != cls->numParents; ++i)
+            addLocked(cls->getParentInfo(i));
+
+        if (!image || !image->matches(classes.size(), cls)) {
+            image.reset();
+            if (frozen)
+                thaw();
+            link(cls);
+        }
+
+        cls->index = classes.size();
+        classes.push_back(cls);
+        linearize(cls);
+        descendants->add(cls, generation + 1);
+
+        if (castLayout)
+            attachCastTable(cls);
+
+        if (registering_module)
+            registering_module->classes.push_back(cls);
+
+        added.push_back(cls);
+    }
+
+    void Hierarchy::remove(const ClassInfo *cls) {
+        removeClasses({&cls, 1});
+    }
+
+    void Hierarchy::remove(Module& module) {
+        removeClasses({module.classes.data(), module.classes.size()});
+        module.classes.clear();
+    }
+
+    void Hierarchy::removeClasses(span<const ClassInfo* const> removed) {
+        std::vector<const ClassInfo*> retiredClasses;
+        std::vector<std::unique_ptr<DefinedClass>> retiredDefinitions;
+        std::vector<std::unique_ptr<const ClassInfo*[]>> retiredLinearizations;
+        std::vector<Impl::retired_t> retiredSnapshots;
+        std::unique_ptr<const Snapshot> retiredCurrent;
+        std::unique_ptr<Snapshot::Tables> retiredTables;
+        std::unique_ptr<Snapshot::Descendants> retiredDescendants;
+
+        {
+            Impl& w = *impl;
+            std::lock_guard<std::mutex> guard(w.writeLock);
+
+            std::unordered_set<const ClassInfo*> removing;
+            for (const ClassInfo* cls : removed) {
+                if (cls->registered.load(std::memory_order_relaxed))
+                    removing.insert(cls);
+            }
+            if (removing.empty())
+                return;
+
+            // It is enough to check direct children: if some descendant
+            // remains, then the topmost remaining class on its path to
+            // removed class is a direct child of removed one.
+            for (const ClassInfo* cls : w.classes) {
+                if (!cls || removing.count(cls))
+                    continue;
+                for (std::size_t i = 0; i != cls->numParents; ++i) {
+                    const ClassInfo* parent = cls->getParentInfo(i);
+                    if (removing.count(parent)) {
+                        std::ostringstream strm;
+                        strm << "Unable to remove class " << parent
+                             << ", class " << cls << " is derived from it.";
+                        throw std::runtime_error(strm.str());
+                    }
+                }
+            }
+
+            // Image is valid for prefix of registration order, which
+            // now has a hole.
+            w.image.reset();
+
+            for (const ClassInfo* cls : removing) {
+                if (!w.frozen) {
+                    w.idToClass.erase(cls->getId());
+                    w.dag.remove(cls->getId());
+                }
+                w.classes[cls->index] = nullptr;
+                retiredLinearizations.push_back(std::move(w.linearizations[cls->index]));
+                retiredClasses.push_back(cls);
+
+                auto defined = w.defined.find(cls);
+                if (defined != end(w.defined)) {
+                    retiredDefinitions.push_back(std::move(defined->second));
+                    w.defined.erase(defined);
+                }
+            }
+
+            // Snapshots share tables, so all of them are replaced by
+            // one computed from scratch.
+            retiredSnapshots = std::move(w.retired);
+            w.retired.clear();
+            retiredCurrent = std::move(w.current);
+            retiredTables = std::move(w.tables);
+
+            // Removed classes are dropped from lists of their ancestors.
+            retiredDescendants = std::exchange(w.descendants, std::make_unique<Snapshot::Descendants>());
+            for (const ClassInfo* cls : w.classes) {
+                if (cls)
+                    w.descendants->add(cls, w.generation + 1);
+            }
+            w.publish();
+        }
+
+        // Lock is released, so registration isn't held by queries.
+        synchronize();
+
+        for (const ClassInfo* cls : retiredClasses) {
+            cls->windupOrder = nullptr;
+            cls->unwindOrder = nullptr;
+            cls->orderSize = 0;
+            cls->castTable.store(nullptr, std::memory_order_relaxed);
+            cls->registered.store(false, std::memory_order_release);
+        }
+    }
+
+    void Hierarchy::Impl::linearize(const ClassInfo *cls) {
+        // Parent linearizations are complete depth first walks, thus
+        // walk of class is a merge of them with duplicates dropped.
+        // Cost is local to class: it doesn't depend on amount of
+        // registered classes.
+        std::vector<const ClassInfo*> windup, unwind;
+
+        if (cls->numParents == 1) {
+            auto parentOrder = windupOf(cls->getParentInfo(0));
+            windup.assign(begin(parentOrder), end(parentOrder));
+            windup.push_back(cls);
+
+            unwind.push_back(cls);
+            parentOrder = unwindOf(cls->getParentInfo(0));
+            unwind.insert(end(unwind), begin(parentOrder), end(parentOrder));
+        } else {
+            std::unordered_set<const ClassInfo*> visited;
+
+            auto append = [&](
+                std::vector<const ClassInfo*>& dest,
+                span<const ClassInfo* const> src
+            ) {
+                for (const ClassInfo* c : src) {
+                    if (visited.insert(c).second)
+                        dest.push_back(c);
+                }
+            };
+
+            for (std::size_t i = 0; i != cls->numParents; ++i)
+                append(windup, windupOf(cls->getParentInfo(i)));
+            windup.push_back(cls);
+
+            visited.clear();
+            visited.insert(cls);
+            unwind.push_back(cls);
+            for (std::size_t i = cls->numParents; i--;)
+                append(unwind, unwindOf(cls->getParentInfo(i)));
+        }
+
+        assert(windup.size() == unwind.size());
+
+        std::size_t n = windup.size();
+        std::unique_ptr<const ClassInfo*[]> storage(new const ClassInfo*[n * 2]);
+        std::copy(begin(windup), end(windup), storage.get());
+        std::copy(begin(unwind), end(unwind), storage.get() + n);
+
+        cls->windupOrder = storage.get();
+        cls->unwindOrder = storage.get() + n;
+        cls->orderSize = n;
+
+        linearizations.push_back(std::move(storage));
+    }
+
+    void Hierarchy::Impl::link(const ClassInfo *cls) {
+        auto clsId = cls->getId();
+
+        auto [it, added] = idToClass.emplace(clsId, cls);
+        if (!added) {
+            std::ostringstream strm;
+            strm << "Class " << cls
+                 << " has colliding id. Unable to maintain hierarchy"
+                 << " consider changing class name or CRC64 initial state.";
+            throw std::runtime_error(strm.str());
+        }
+
+        bool inserted = dag.add(clsId, cls->getParents());
+        assert(inserted && "We can register each class only once.");
+        (void)inserted;
+    }
+
+    void Hierarchy::freeze() {
+        std::lock_guard<std::mutex> guard(impl->writeLock);
+        impl->freezeLocked();
+        freezePending.store(false, std::memory_order_relaxed);
+    }
+
+    void Hierarchy::Impl::freezeLocked() {
+        dag = DAG<class_id_t>();
+        idToClass = classes_map_t();
+        frozen = true;
+    }
+
+    void Hierarchy::Impl::thaw() {
+        for (const ClassInfo* cls : classes) {
+            if (cls)
+                link(cls);
+        }
+        frozen = false;
+    }
+
+    void Hierarchy::saveImage(const std::string& path) const {
+        ReadGuard guard;
+        const Snapshot* s = view();
+
+        std::ofstream f(path, std::ios::binary | std::ios::trunc);
+        if (!f)
+            throw std::runtime_error("Unable to open '" + path + "' for writing.");
+
+        s->save(f);
+
+        if (!f.flush())
+            throw std::runtime_error("Unable to write hierarchy image '" + path + "'.");
+    }
+
+    bool Hierarchy::loadImage(const std::string& path) {
+        auto loaded = HierarchyImage::map(path);
+
+        Impl& w = *impl;
+        std::lock_guard<std::mutex> guard(w.writeLock);
+
+        if (!loaded || loaded->size() != w.classes.size())
+            return false;
+        for (std::size_t i = 0; i != w.classes.size(); ++i) {
+            if (!w.classes[i] || !loaded->matches(i, w.classes[i]))
+                return false;
+        }
+
+        w.image = std::move(loaded);
+        w.freezeLocked();
+        freezePending.store(false, std::memory_order_relaxed);
+
+        // Make readers pick snapshot based on image.
+        w.publish();
+        return true;
+    }
+
+    void Hierarchy::setAutoFreeze(bool enabled) {
+        std::lock_guard<std::mutex> guard(impl->writeLock);
+        impl->autoFreeze = enabled;
+        freezePending.store(enabled && !impl->frozen, std::memory_order_relaxed);
+    }
+
+    bool Hierarchy::isFrozen() const {
+        std::lock_guard<std::mutex> guard(impl->writeLock);
+        return impl->frozen;
+    }
+
+    bool Hierarchy::isParent(class_id_t child, class_id_t parent) const {
+        ReadGuard guard;
+        return view()->isParent(child, parent);
+    }
+
+    bool Hierarchy::windup(class_id_t clsid, const node_callback_t& onNode) const {
+        ReadGuard guard;
+        const ClassInfo* cls = getClassInfo(clsid);
+        if (!cls)
+            return true;
+        for (const ClassInfo* c : windup_order(cls)) {
+            if (!onNode(c))
+                return false;
+        }
+        return true;
+    }
+
+    bool Hierarchy::unwind(class_id_t clsid, const node_callback_t& onNode) const {
+        ReadGuard guard;
+        const ClassInfo* cls = getClassInfo(clsid);
+        if (!cls)
+            return true;
+        for (const ClassInfo* c : unwind_order(cls)) {
+            if (!onNode(c))
+                return false;
+        }
+        return true;
+    }
+
+    const ClassInfo* Hierarchy::getClassInfo(class_id_t clsid) const {
+        ReadGuard guard;
+        return view()->getClassInfo(clsid);
+    }
+
+    const ClassInfo* Hierarchy::getClassInfo(const class_name_t& name) const {
+        ReadGuard guard;
+        return view()->getClassInfo(name);
+    }
+
+    std::vector<const ClassInfo*> Hierarchy::getClassesByName(const class_name_t& name) const {
+        ReadGuard guard;
+        return view()->getClassesByName(name);
+    }
+
+    std::vector<const ClassInfo*> Hierarchy::commonAncestors(class_id_t a, class_id_t b) const {
+        class_id_t ids[] = {a, b};
+        ReadGuard guard;
+        return view()->commonAncestors({ids, 2});
+    }
+
+    std::vector<const ClassInfo*> Hierarchy::commonAncestors(span<const class_id_t> ids) const {
+        ReadGuard guard;
+        return view()->commonAncestors(ids);
+    }
+
+    span<const ClassInfo* const> Hierarchy::descendants(class_id_t clsid, bool byDepth) const {
+        ReadGuard guard;
+        return view()->getDescendants(clsid, byDepth);
+    }
+
+    Hierarchy::memory_stats_t Hierarchy::memoryStats() const {
+        memory_stats_t res;
+
+        Impl& w = *impl;
+        std::lock_guard<std::mutex> guard(w.writeLock);
+
+        res.linearizations = vector_bytes(w.classes) + vector_bytes(w.linearizations);
+        res.idToClass = node_container_bytes(w.idToClass);
+        res.dag = w.dag.memoryUsage();
+
+        res.classInfos = node_container_bytes(w.defined);
+        for (const auto& [_, cls] : w.defined) {
+            res.classInfos += sizeof(DefinedClass) + cls->name.capacity() + 1
+                + vector_bytes(cls->parents) + vector_bytes(cls->parentIds);
+        }
+
+        for (const ClassInfo* cls : w.classes) {
+            if (!cls)
+                continue;
+
+            // Class of failed batch is not registered, and registering
+            // accessor would take writer lock again.
+            auto lineage = Impl::windupOf(cls);
+            res.linearizations += lineage.size() * 2 * sizeof(const ClassInfo*);
+
+            // Defined classes are accounted along with their storage.
+            if (!w.defined.count(cls))
+                res.classInfos += sizeof(ClassInfo);
+
+            // Repeat construction of object: Object puts itself, then
+            // each class of lineage follows.
+            std::size_t bytes = 0;
+            counted_container_t<Object::cross_ptrs_t> crossPtrs(
+                {{Object::class_id(), nullptr}},
+                counting_allocator<Object::cross_ptrs_t::value_type>(&bytes)
+            );
+            for (const ClassInfo* c : lineage)
+                crossPtrs[c->getId()] = nullptr;
+
+            res.crossPtrs.push_back({cls, crossPtrs.size(), bytes});
+        }
+
+        if (w.tables)
+            res.tables = w.tables->memoryUsage();
+
+        res.descendants = w.descendants->memoryUsage();
+        for (const auto& r : w.retired) {
+            for (const auto& list : r.lists)
+                res.descendants += list->memoryUsage();
+        }
+
+        // Image is kept by snapshots created over it, even once it has
+        // been detached from registry.
+        std::unordered_set<const HierarchyImage*> images{w.image.get(), w.current->getImage()};
+        for (const auto& r : w.retired)
+            images.insert(r.snapshot->getImage());
+        for (const HierarchyImage* image : images)
+            res.image += image ? image->bytes() : 0;
+
+        res.snapshots = w.current->memoryUsage() + vector_bytes(w.retired);
+        for (const auto& r : w.retired)
+            res.snapshots += r.snapshot->memoryUsage();
+
+        return res;
+    }
+
+    void Hierarchy::setCastLayout(std::shared_ptr<const CastLayout> layout) {
+        std::shared_ptr<const CastLayout> replaced;
+        {
+            std::lock_guard<std::mutex> guard(impl->writeLock);
+            replaced = std::exchange(impl->castLayout, std::move(layout));
+            for (const ClassInfo* cls : impl->classes) {
+                if (cls)
+                    impl->attachCastTable(cls);
+            }
+        }
+
+        // Casts started before might still use replaced tables.
+        if (replaced)
+            synchronize();
+    }
+
+    void Hierarchy::Impl::attachCastTable(const ClassInfo* cls) {
+        // seq_cst: casts load table after they enter CastTableGuard, see
+        // Object::findCrossPtr.
+        cls->castTable.store(
+            castLayout ? castLayout->find(cls->getId()) : nullptr,
+            std::memory_order_seq_cst
+        );
+    }
+
+    namespace details {
+        CastTableGuard::CastTableGuard() {
+            enter_read();
+        }
+
+        CastTableGuard::~CastTableGuard() {
+            leave_read();
+        }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,851 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MYRTTI_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "hierarchy_snapshot.h"
+
+namespace myrtti {
+
+namespace {
+    using index_t = uint32_t;
+    using indices_t = std::vector<index_t>;
+
+    constexpr char image_magic[8] = {'M', 'Y', 'R', 'T', 'T', 'I', 'H', '\0'};
+    constexpr uint32_t byte_order_mark = 0x01020304;
+
+    /// @brief Capacity of open addressing table for n items: power of 2,
+    /// at least twice bigger than n.
+    std::size_t table_capacity(std::size_t n) {
+        std::size_t capacity = 2;
+        while (capacity < n * 2)
+            capacity <<= 1;
+        return capacity;
+    }
+
+    template<typename T>
+    span<const T> as_span(const std::vector<T>& v) { return {v.data(), v.size()}; }
+
+    /// @brief Inverts CSR relation: if j is related to i in source,
+    /// then i is related to j in result, items go in ascending order.
+    void invert(
+        span<const index_t> srcBegin, span<const index_t> src,
+        indices_t& dstBegin, indices_t& dst
+    ) {
+        std::size_t n = srcBegin.size() - 1;
+
+        dstBegin.assign(n + 1, 0);
+        for (index_t j : src)
+            ++dstBegin[j + 1];
+        for (std::size_t i = 0; i != n; ++i)
+            dstBegin[i + 1] += dstBegin[i];
+
+        dst.resize(src.size());
+        indices_t fill(begin(dstBegin), end(dstBegin) - 1);
+        for (std::size_t i = 0; i != n; ++i) {
+            for (index_t k = srcBegin[i]; k != srcBegin[i + 1]; ++k)
+                dst[fill[src[k]]++] = index_t(i);
+        }
+    }
+}
+
+//
+// Snapshot
+//
+
+void Hierarchy::Snapshot::SlotTable::reserve(std::size_t size) {
+    if (size * 2 <= slots.size())
+        return;
+
+    std::size_t capacity = table_capacity(size);
+    std::unique_ptr<Slot[]> table(new Slot[capacity]);
+    uint64_t tableMask = capacity - 1;
+
+    // Keys are unique, so they may be moved in any order.
+    for (const Slot& slot : slots) {
+        index_t i = slot.index.load(std::memory_order_relaxed);
+        if (i == no_index)
+            continue;
+        uint64_t id = slot.id.load(std::memory_order_relaxed);
+        std::size_t s = id & tableMask;
+        while (table[s].index.load(std::memory_order_relaxed) != no_index)
+            s = (s + 1) & tableMask;
+        table[s].id.store(id, std::memory_order_relaxed);
+        table[s].index.store(i, std::memory_order_relaxed);
+    }
+
+    slots = {table.get(), capacity};
+    mask = tableMask;
+    allocated += capacity;
+    tables.push_back(std::move(table));
+}
+
+std::size_t Hierarchy::Snapshot::SlotTable::memoryUsage() const {
+    return allocated * sizeof(Slot) + tables.capacity() * sizeof(tables[0]);
+}
+
+Hierarchy::Snapshot::Tables::Tables(const Snapshot* base)
+: sets(base ? CompressedSetsBuilder(base->ancestors) : CompressedSetsBuilder())
+{
+    if (!base) {
+        parentsBegin.push_back(0);
+        return;
+    }
+
+    std::size_t n = base->classes.size();
+    classes.append(begin(base->classes), end(base->classes));
+
+    // Base slots are copied to empty tables, so probing starts from
+    // scratch. Base might cover prefix of image, items of further image
+    // classes are dropped.
+    auto copySlots = [&](SlotTable& dst, span<const Slot> src) {
+        dst.reserve(n);
+        for (const Slot& slot : src) {
+            index_t i = slot.index.load(std::memory_order_relaxed);
+            if (i >= n)
+                continue;
+            uint64_t id = slot.id.load(std::memory_order_relaxed);
+            std::size_t s = id & dst.mask;
+            while (dst.slots[s].index.load(std::memory_order_relaxed) != no_index)
+                s = (s + 1) & dst.mask;
+            dst.slots[s].id.store(id, std::memory_order_relaxed);
+            dst.slots[s].index.store(i, std::memory_order_relaxed);
+        }
+    };
+    copySlots(slots, base->slots);
+    copySlots(nameSlots, base->nameSlots);
+
+    nameNext.reserve(n);
+    for (std::size_t i = 0; i != n; ++i)
+        nameNext.push_back(base->nextByName(i));
+    parentsBegin.append(begin(base->parentsBegin), end(base->parentsBegin));
+    parents.append(begin(base->parents), end(base->parents));
+    ancestorSets.append(begin(base->ancestorSets), end(base->ancestorSets));
+}
+
+std::size_t Hierarchy::Snapshot::Tables::memoryUsage() const {
+    return classes.memoryUsage()
+        + slots.memoryUsage()
+        + nameSlots.memoryUsage()
+        + nameNext.memoryUsage()
+        + parentsBegin.memoryUsage()
+        + parents.memoryUsage()
+        + ancestorSets.memoryUsage()
+        + sets.memoryUsage();
+}
+
+void Hierarchy::Snapshot::Tables::extend(span<const ClassInfo* const> src) {
+    std::size_t known = classes.size();
+    std::size_t n = src.size();
+    assert(known <= n);
+
+    slots.reserve(n);
+    nameSlots.reserve(n);
+    classes.reserve(n);
+    nameNext.reserve(n);
+    parentsBegin.reserve(n + 1);
+    ancestorSets.reserve(n);
+
+    // Items of new classes are written before snapshot which includes
+    // them is published, and older snapshots skip them, so relaxed
+    // stores are enough.
+    auto fill = [](Slot& slot, uint64_t id, index_t i) {
+        slot.id.store(id, std::memory_order_relaxed);
+        slot.index.store(i, std::memory_order_relaxed);
+    };
+
+    auto findClass = [&](class_id_t id) {
+        for (std::size_t s = id.value & slots.mask;; s = (s + 1) & slots.mask) {
+            const Slot& slot = slots.slots[s];
+            index_t i = slot.index.load(std::memory_order_relaxed);
+            if (i == no_index || slot.id.load(std::memory_order_relaxed) == id.value)
+                return i;
+        }
+    };
+
+    // Classes of the same name are chained in registration order, so new
+    // classes are appended to chains tails.
+    auto insertName = [&](index_t i) {
+        class_name_t name(classes[i]->name);
+        for (std::size_t s = name.hash & nameSlots.mask;; s = (s + 1) & nameSlots.mask) {
+            Slot& slot = nameSlots.slots[s];
+            index_t head = slot.index.load(std::memory_order_relaxed);
+            if (head == no_index) {
+                fill(slot, name.hash, i);
+                return;
+            }
+            if (slot.id.load(std::memory_order_relaxed) == name.hash
+                && name.name == classes[head]->name) {
+                index_t last = head;
+                while (nameNext[last].load(std::memory_order_relaxed) != no_index)
+                    last = nameNext[last].load(std::memory_order_relaxed);
+                nameNext[last].store(i, std::memory_order_relaxed);
+                return;
+            }
+        }
+    };
+
+    indices_t clsAncestors;
+    for (std::size_t i = known; i != n; ++i) {
+        const ClassInfo* cls = src[i];
+        classes.push_back(cls);
+        nameNext.push_back(no_index);
+
+        clsAncestors.clear();
+        if (cls) {
+            uint64_t id = cls->getId().value;
+            std::size_t s = id & slots.mask;
+            while (slots.slots[s].index.load(std::memory_order_relaxed) != no_index)
+                s = (s + 1) & slots.mask;
+            fill(slots.slots[s], id, index_t(i));
+
+            insertName(index_t(i));
+
+            for (auto pid : cls->getParents()) {
+                index_t p = findClass(pid);
+                assert(p < i && "Parents should be registered before children.");
+                parents.push_back(p);
+                clsAncestors.push_back(p);
+                sets.current().forEach(ancestorSets[p], [&](index_t a) {
+                    clsAncestors.push_back(a);
+                });
+            }
+            std::sort(begin(clsAncestors), end(clsAncestors));
+            clsAncestors.erase(
+                std::unique(begin(clsAncestors), end(clsAncestors)),
+                end(clsAncestors)
+            );
+        }
+        ancestorSets.push_back(sets.add(as_span(clsAncestors)));
+        parentsBegin.push_back(parents.size());
+    }
+}
+
+Hierarchy::Snapshot::Snapshot(
+    uint64_t generation,
+    const std::vector<const ClassInfo*>& src,
+    Tables& tables,
+    const Descendants& d
+)
+: generation(generation) {
+    tables.extend(as_span(src));
+
+    classes = tables.classes.view();
+    slots = {tables.slots.slots.data(), tables.slots.slots.size()};
+    slotsMask = tables.slots.mask;
+    nameSlots = {tables.nameSlots.slots.data(), tables.nameSlots.slots.size()};
+    nameSlotsMask = tables.nameSlots.mask;
+    nameNext = tables.nameNext.view();
+    parentsBegin = tables.parentsBegin.view();
+    parents = tables.parents.view();
+    ancestorSets = tables.ancestorSets.view();
+    ancestors = tables.sets.view();
+    descendants[0] = d.lists[0].view();
+    descendants[1] = d.lists[1].view();
+}
+
+Hierarchy::Snapshot::Snapshot(
+    uint64_t generation,
+    const std::vector<const ClassInfo*>& src,
+    std::shared_ptr<const HierarchyImage> img,
+    const Descendants& d
+)
+: generation(generation), image(std::move(img)), imageClasses(src) {
+    assert(imageClasses.size() <= image->size());
+
+    // While classes are still being registered, snapshot covers prefix
+    // of image: per class arrays are cut, slots and name chains of
+    // further classes are skipped as for computed tables.
+    std::size_t n = imageClasses.size();
+    auto beginning = [](auto items, std::size_t size) {
+        return decltype(items)(items.data(), size);
+    };
+
+    classes = as_span(imageClasses);
+    slots = image->get<Slot>(HierarchyImage::section_slots);
+    slotsMask = image->header->slotsMask;
+    nameSlots = image->get<Slot>(HierarchyImage::section_name_slots);
+    nameSlotsMask = image->header->nameSlotsMask;
+    nameNext = beginning(image->get<std::atomic<index_t>>(HierarchyImage::section_name_next), n);
+    parentsBegin = beginning(image->get<index_t>(HierarchyImage::section_parents_begin), n + 1);
+    parents = beginning(image->get<index_t>(HierarchyImage::section_parents), parentsBegin[n]);
+    ancestorSets = beginning(image->get<index_t>(HierarchyImage::section_ancestor_sets), n);
+    ancestors = {
+        image->get<uint32_t>(HierarchyImage::section_sets_begin),
+        image->get<compressed_sets_t::container_t>(HierarchyImage::section_set_containers),
+        image->get<uint16_t>(HierarchyImage::section_set_pool)
+    };
+    descendants[0] = d.lists[0].view();
+    descendants[1] = d.lists[1].view();
+}
+
+Hierarchy::Snapshot::~Snapshot() {
+    delete derivedRelations.load(std::memory_order_relaxed);
+}
+
+std::size_t Hierarchy::Snapshot::memoryUsage() const {
+    std::size_t res = sizeof(*this) + vector_bytes(imageClasses);
+
+    const Derived* d = derivedRelations.load(std::memory_order_acquire);
+    if (!d)
+        return res;
+
+    return res + sizeof(Derived) + vector_bytes(d->computedBegin) + vector_bytes(d->computed);
+}
+
+const Hierarchy::Snapshot::Derived& Hierarchy::Snapshot::derived() const {
+    const Derived* d = derivedRelations.load(std::memory_order_acquire);
+    if (d)
+        return *d;
+
+    auto fresh = std::make_unique<Derived>();
+    if (image && image->size() == classes.size()) {
+        fresh->childrenBegin = image->get<index_t>(HierarchyImage::section_children_begin);
+        fresh->children = image->get<index_t>(HierarchyImage::section_children);
+    } else {
+        invert(parentsBegin, parents, fresh->computedBegin, fresh->computed);
+        fresh->childrenBegin = as_span(fresh->computedBegin);
+        fresh->children = as_span(fresh->computed);
+    }
+
+    if (derivedRelations.compare_exchange_strong(d, fresh.get(), std::memory_order_acq_rel))
+        d = fresh.release();
+    return *d;
+}
+
+std::vector<const ClassInfo*> Hierarchy::Snapshot::getClassesByName(const class_name_t& name) const {
+    std::vector<const ClassInfo*> res;
+    for (index_t i = findByName(name); i != no_index; i = nextByName(i))
+        res.push_back(classes[i]);
+    return res;
+}
+
+bool Hierarchy::Snapshot::isParent(class_id_t child, class_id_t parent) const {
+    index_t c = find(child);
+    index_t p = find(parent);
+    if (c == no_index || p == no_index)
+        return false;
+    return ancestors.contains(ancestorSets[c], p);
+}
+
+std::vector<const ClassInfo*> Hierarchy::Snapshot::commonAncestors(span<const class_id_t> ids) const {
+    if (ids.empty())
+        return {};
+
+    // Candidates are the first class and its ancestors, keep ones
+    // which are in lineage of all other classes.
+    index_t first = find(ids[0]);
+    if (first == no_index)
+        return {};
+
+    indices_t common;
+    ancestors.forEach(ancestorSets[first], [&](index_t a) { common.push_back(a); });
+    common.insert(std::upper_bound(begin(common), end(common), first), first);
+
+    for (std::size_t k = 1; k != ids.size() && !common.empty(); ++k) {
+        index_t i = find(ids[k]);
+        if (i == no_index)
+            return {};
+        common.erase(
+            std::remove_if(begin(common), end(common), [&](index_t c) {
+                return c != i && !ancestors.contains(ancestorSets[i], c);
+            }),
+            end(common)
+        );
+    }
+
+    // Keep most derived classes only: drop ancestors of each
+    // common class.
+    std::vector<bool> dropped(common.size());
+    for (index_t c : common) {
+        ancestors.forEach(ancestorSets[c], [&](index_t a) {
+            auto it = std::lower_bound(begin(common), end(common), a);
+            if (it != end(common) && *it == a)
+                dropped[it - begin(common)] = true;
+        });
+    }
+
+    std::vector<const ClassInfo*> res;
+    for (std::size_t k = 0; k != common.size(); ++k) {
+        if (!dropped[k])
+            res.push_back(classes[common[k]]);
+    }
+    return res;
+}
+
+span<const ClassInfo* const> Hierarchy::Snapshot::getDescendants(class_id_t clsid, bool byDepth) const {
+    index_t i = find(clsid);
+    if (i == no_index)
+        return {};
+
+    const Descendants::list_t* list = descendants[byDepth][i].load(std::memory_order_acquire);
+    while (list && list->generation > generation)
+        list = list->prev;
+    if (!list)
+        return {};
+
+    // Classes appended after snapshot has been published go last.
+    const ClassInfo* const* items = list->items.get();
+    index_t size = list->size.load(std::memory_order_acquire);
+    std::size_t n = classes.size();
+    if (size && items[size - 1]->getIndex() >= n) {
+        size = std::partition_point(items, items + size, [&](const ClassInfo* c) {
+            return c->getIndex() < n;
+        }) - items;
+    }
+    return {items, size};
+}
+
+//
+// Hierarchy::Snapshot::Descendants
+//
+
+Hierarchy::Snapshot::Descendants::~Descendants() {
+    for (auto& heads : lists) {
+        for (std::size_t i = 0; i != heads.size(); ++i)
+            delete heads[i].load(std::memory_order_relaxed);
+    }
+}
+
+std::size_t Hierarchy::Snapshot::Descendants::memoryUsage() const {
+    std::size_t res = 0;
+    for (const auto& heads : lists) {
+        res += heads.memoryUsage();
+        for (std::size_t i = 0; i != heads.size(); ++i) {
+            if (const list_t* list = heads[i].load(std::memory_order_relaxed))
+                res += list->memoryUsage();
+        }
+    }
+    for (const auto& list : replaced)
+        res += list->memoryUsage();
+    return res;
+}
+
+void Hierarchy::Snapshot::Descendants::add(const ClassInfo* cls, uint64_t generation) {
+    for (auto& heads : lists) {
+        while (heads.size() <= cls->index)
+            heads.push_back(nullptr);
+    }
+
+    // Distance from ancestor is one more than from the closest parent,
+    // parents lists are complete already.
+    for (std::size_t k = 0; k + 1 < cls->orderSize; ++k) {
+        const ClassInfo* ancestor = cls->windupOrder[k];
+
+        index_t depth = no_index;
+        for (std::size_t i = 0; i != cls->numParents; ++i) {
+            const ClassInfo* parent = cls->getParentInfo(i);
+            index_t d = parent == ancestor ? 0 : depthOf(ancestor, parent);
+            if (d != no_index)
+                depth = std::min(depth, d + 1);
+        }
+        assert(depth != no_index);
+
+        insert(lists[0][ancestor->index], cls, depth, false, generation);
+        insert(lists[1][ancestor->index], cls, depth, true, generation);
+    }
+}
+
+Hierarchy::Snapshot::index_t Hierarchy::Snapshot::Descendants::depthOf(
+    const ClassInfo* ancestor, const ClassInfo* cls
+) const {
+    const list_t* list = lists[0][ancestor->index].load(std::memory_order_relaxed);
+    if (!list)
+        return no_index;
+
+    // List in registration order is sorted by index.
+    const ClassInfo* const* items = list->items.get();
+    const ClassInfo* const* end = items + list->size.load(std::memory_order_relaxed);
+    auto found = std::lower_bound(items, end, cls, [](const ClassInfo* l, const ClassInfo* r) {
+        return l->index < r->index;
+    });
+    return found != end && *found == cls ? list->depths[found - items] : no_index;
+}
+
+void Hierarchy::Snapshot::Descendants::insert(
+    std::atomic<list_t*>& head, const ClassInfo* cls, index_t depth,
+    bool byDepth, uint64_t generation
+) {
+    list_t* list = head.load(std::memory_order_relaxed);
+    index_t size = list ? list->size.load(std::memory_order_relaxed) : 0;
+
+    index_t pos = size;
+    if (byDepth && size)
+        pos = std::upper_bound(list->depths.get(), list->depths.get() + size, depth) - list->depths.get();
+
+    // Published list is only appended to, list no snapshot sees yet
+    // might be updated anywhere.
+    if (list && size < list->capacity && (pos == size || list->generation == generation)) {
+        std::copy_backward(list->items.get() + pos, list->items.get() + size, list->items.get() + size + 1);
+        std::copy_backward(list->depths.get() + pos, list->depths.get() + size, list->depths.get() + size + 1);
+        list->items[pos] = cls;
+        list->depths[pos] = depth;
+        list->size.store(size + 1, std::memory_order_release);
+        return;
+    }
+
+    auto fresh = std::make_unique<list_t>();
+    fresh->generation = generation;
+    fresh->prev = list && list->generation == generation ? list->prev : list;
+    fresh->capacity = std::max<std::size_t>(4, std::size_t(size) * 2);
+    fresh->items.reset(new const ClassInfo*[fresh->capacity]);
+    fresh->depths.reset(new index_t[fresh->capacity]);
+    if (list) {
+        std::copy(list->items.get(), list->items.get() + pos, fresh->items.get());
+        std::copy(list->items.get() + pos, list->items.get() + size, fresh->items.get() + pos + 1);
+        std::copy(list->depths.get(), list->depths.get() + pos, fresh->depths.get());
+        std::copy(list->depths.get() + pos, list->depths.get() + size, fresh->depths.get() + pos + 1);
+    }
+    fresh->items[pos] = cls;
+    fresh->depths[pos] = depth;
+    fresh->size.store(size + 1, std::memory_order_relaxed);
+
+    head.store(fresh.release(), std::memory_order_release);
+    if (list)
+        replaced.emplace_back(list);
+}
+
+void Hierarchy::Snapshot::save(std::ostream& s) const {
+    using header_t = HierarchyImage::header_t;
+
+    std::size_t n = classes.size();
+
+    std::vector<uint64_t> ids;
+    std::vector<uint32_t> nameOffsets;
+    std::string names;
+    ids.reserve(n);
+    nameOffsets.reserve(n + 1);
+    for (const ClassInfo* cls : classes) {
+        // Removed classes leave empty entries.
+        ids.push_back(cls ? cls->getId().value : 0);
+        nameOffsets.push_back(names.size());
+        names.append(cls ? cls->name : "").push_back('\0');
+    }
+    nameOffsets.push_back(names.size());
+
+    // Tables might have been extended since snapshot was taken, items
+    // of classes registered afterwards are dropped.
+    struct raw_slot_t {
+        uint64_t id;
+        index_t index;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(raw_slot_t) == sizeof(Slot));
+
+    auto rawSlots = [&](span<const Slot> src) {
+        std::vector<raw_slot_t> res;
+        res.reserve(src.size());
+        for (const Slot& slot : src) {
+            index_t i = slot.index.load(std::memory_order_relaxed);
+            if (i < n)
+                res.push_back({slot.id.load(std::memory_order_relaxed), i, 0});
+            else
+                res.push_back({0, no_index, 0});
+        }
+        return res;
+    };
+    auto rawIdSlots = rawSlots(slots);
+    auto rawNameSlots = rawSlots(nameSlots);
+
+    indices_t rawNameNext;
+    rawNameNext.reserve(n);
+    for (std::size_t i = 0; i != n; ++i)
+        rawNameNext.push_back(nextByName(i));
+
+    const Derived& d = derived();
+
+    header_t header{};
+    std::memcpy(header.magic, image_magic, sizeof(image_magic));
+    header.version = HierarchyImage::version;
+    header.byteOrder = byte_order_mark;
+    header.numClasses = n;
+    header.numSets = ancestors.setsBegin.size() - 1;
+    header.slotsMask = slotsMask;
+    header.nameSlotsMask = nameSlotsMask;
+
+    struct section_data_t {
+        const void* data;
+        std::size_t size;
+        std::size_t itemSize;
+    };
+
+    auto section = [](auto items) {
+        return section_data_t{items.data(), items.size(), sizeof(*items.data())};
+    };
+
+    section_data_t sections[HierarchyImage::num_sections] = {
+        section(as_span(ids)),
+        section(as_span(nameOffsets)),
+        section(span<const char>(names.data(), names.size())),
+        section(as_span(rawIdSlots)),
+        section(as_span(rawNameSlots)),
+        section(as_span(rawNameNext)),
+        section(parentsBegin),
+        section(parents),
+        section(ancestorSets),
+        section(ancestors.setsBegin),
+        section(ancestors.containers),
+        section(ancestors.pool),
+        section(d.childrenBegin),
+        section(d.children),
+    };
+
+    auto align = [](std::size_t offset) { return (offset + 7) & ~std::size_t(7); };
+
+    std::size_t offset = align(sizeof(header_t));
+    for (std::size_t i = 0; i != HierarchyImage::num_sections; ++i) {
+        header.sections[i].offset = offset;
+        header.sections[i].size = sections[i].size;
+        offset = align(offset + sections[i].size * sections[i].itemSize);
+    }
+
+    static const char padding[8] = {};
+
+    std::size_t written = 0;
+    auto write = [&](const void* data, std::size_t size) {
+        s.write(static_cast<const char*>(data), size);
+        written += size;
+        s.write(padding, align(written) - written);
+        written = align(written);
+    };
+
+    write(&header, sizeof(header));
+    for (const auto& sec : sections)
+        write(sec.data, sec.size * sec.itemSize);
+}
+
+//
+// HierarchyImage
+//
+
+std::shared_ptr<const HierarchyImage> HierarchyImage::map(const std::string& path) {
+    std::shared_ptr<HierarchyImage> image(new HierarchyImage());
+
+    #ifdef MYRTTI_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < off_t(sizeof(header_t))) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    void* addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+        return nullptr;
+
+    image->data = static_cast<const char*>(addr);
+    image->length = st.st_size;
+    #else
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    if (!f)
+        return nullptr;
+
+    std::size_t size = f.tellg();
+    if (size < sizeof(header_t))
+        return nullptr;
+
+    // uint64_t buffer, so arrays are aligned.
+    image->buffer.reset(new uint64_t[(size + 7) / 8]);
+    f.seekg(0);
+    if (!f.read(reinterpret_cast<char*>(image->buffer.get()), size))
+        return nullptr;
+
+    image->data = reinterpret_cast<const char*>(image->buffer.get());
+    image->length = size;
+    #endif
+
+    image->header = reinterpret_cast<const header_t*>(image->data);
+    if (!image->validate())
+        return nullptr;
+
+    return image;
+}
+
+HierarchyImage::~HierarchyImage() {
+    #ifdef MYRTTI_HAS_MMAP
+    if (data)
+        ::munmap(const_cast<char*>(data), length);
+    #endif
+}
+
+bool HierarchyImage::validate() const {
+    if (std::memcmp(header->magic, image_magic, sizeof(image_magic)) != 0
+        || header->version != version
+        || header->byteOrder != byte_order_mark)
+        return false;
+
+    static constexpr std::size_t itemSizes[num_sections] = {
+        sizeof(uint64_t), sizeof(uint32_t), sizeof(char), sizeof(Slot),
+        sizeof(Slot), sizeof(index_t),
+        sizeof(index_t), sizeof(index_t), sizeof(index_t), sizeof(uint32_t),
+        sizeof(compressed_sets_t::container_t), sizeof(uint16_t),
+        sizeof(index_t), sizeof(index_t)
+    };
+
+    for (std::size_t i = 0; i != num_sections; ++i) {
+        const auto& s = header->sections[i];
+        if (s.offset % 8 || s.offset > length
+            || s.size > (length - s.offset) / itemSizes[i])
+            return false;
+    }
+
+    std::size_t n = header->numClasses;
+    std::size_t numSets = header->numSets;
+    uint64_t slotsMask = header->slotsMask;
+    uint64_t nameSlotsMask = header->nameSlotsMask;
+
+    if (get<uint64_t>(section_ids).size() != n
+        || get<uint32_t>(section_name_offsets).size() != n + 1
+        || get<index_t>(section_ancestor_sets).size() != n
+        || get<uint32_t>(section_sets_begin).size() != numSets + 1
+        || get<Slot>(section_slots).size() != slotsMask + 1
+        || (slotsMask & (slotsMask + 1)) || slotsMask + 1 < n * 2
+        || get<Slot>(section_name_slots).size() != nameSlotsMask + 1
+        || (nameSlotsMask & (nameSlotsMask + 1)) || nameSlotsMask + 1 < n * 2
+        || get<index_t>(section_name_next).size() != n)
+        return false;
+
+    // Names are null terminated.
+    auto nameOffsets = get<uint32_t>(section_name_offsets);
+    auto names = get<char>(section_names);
+    if (nameOffsets[n] != names.size())
+        return false;
+    for (std::size_t i = 0; i != n; ++i) {
+        if (nameOffsets[i] >= nameOffsets[i + 1] || names[nameOffsets[i + 1] - 1] != '\0')
+            return false;
+    }
+
+    for (auto section : {section_slots, section_name_slots}) {
+        for (const auto& slot : get<Slot>(section)) {
+            index_t i = slot.index.load(std::memory_order_relaxed);
+            if (i != Hierarchy::Snapshot::no_index && i >= n)
+                return false;
+        }
+    }
+
+    // Chains of the same name classes go forward, so they can't loop.
+    auto nameNext = get<index_t>(section_name_next);
+    for (std::size_t i = 0; i != n; ++i) {
+        if (nameNext[i] != Hierarchy::Snapshot::no_index && (nameNext[i] >= n || nameNext[i] <= i))
+            return false;
+    }
+
+    // Relations: begins are monotonic, items are valid indices.
+    auto validRelation = [&](section_t beginsSection, section_t itemsSection) {
+        auto begins = get<index_t>(beginsSection);
+        auto items = get<index_t>(itemsSection);
+        if (begins.size() != n + 1 || begins[0] != 0 || begins[n] != items.size())
+            return false;
+        for (std::size_t i = 0; i != n; ++i) {
+            if (begins[i] > begins[i + 1])
+                return false;
+        }
+        for (index_t item : items) {
+            if (item >= n)
+                return false;
+        }
+        return true;
+    };
+
+    if (!validRelation(section_parents_begin, section_parents)
+        || !validRelation(section_children_begin, section_children))
+        return false;
+
+    // Ancestor sets: containers are within pool and go in ascending
+    // keys order, all values are valid indices.
+    for (index_t set : get<index_t>(section_ancestor_sets)) {
+        if (set >= numSets)
+            return false;
+    }
+
+    using container_t = compressed_sets_t::container_t;
+    compressed_sets_t sets{
+        get<uint32_t>(section_sets_begin),
+        get<container_t>(section_set_containers),
+        get<uint16_t>(section_set_pool)
+    };
+
+    if (sets.setsBegin[0] != 0 || sets.setsBegin[numSets] != sets.containers.size())
+        return false;
+
+    for (const container_t& c : sets.containers) {
+        std::size_t size = c.kind == compressed_sets_t::kind_bitmap
+            ? compressed_sets_t::bitmap_words
+            : c.size;
+        if (c.kind > compressed_sets_t::kind_bitmap
+            || c.offset > sets.pool.size()
+            || size > sets.pool.size() - c.offset)
+            return false;
+    }
+
+    for (std::size_t set = 0; set != numSets; ++set) {
+        uint32_t b = sets.setsBegin[set];
+        uint32_t e = sets.setsBegin[set + 1];
+        if (b > e || e > sets.containers.size())
+            return false;
+        for (uint32_t k = b + 1; k < e; ++k) {
+            if (sets.containers[k - 1].key >= sets.containers[k].key)
+                return false;
+        }
+    }
+
+    bool validValues = true;
+    for (std::size_t set = 0; set != numSets && validValues; ++set)
+        sets.forEach(set, [&](uint32_t v) { validValues = validValues && v < n; });
+
+    return validValues;
+}
+
+bool HierarchyImage::matches(index_t i, const ClassInfo* cls) const {
+    if (i >= size())
+        return false;
+
+    auto ids = get<uint64_t>(section_ids);
+    if (ids[i] != cls->getId().value)
+        return false;
+
+    const char* name = get<char>(section_names).data() + get<uint32_t>(section_name_offsets)[i];
+    if (std::strcmp(name, cls->name) != 0)
+        return false;
+
+    auto parentsBegin = get<index_t>(section_parents_begin);
+    auto parents = get<index_t>(section_parents);
+    auto clsParents = cls->getParents();
+
+    if (parentsBegin[i + 1] - parentsBegin[i] != clsParents.size())
+        return false;
+    for (std::size_t k = 0; k != clsParents.size(); ++k) {
+        if (ids[parents[parentsBegin[i] + k]] != clsParents[k].value)
+            return false;
+    }
+    return true;
+}
+
+} // namespace myrtti
@@ -0,0 +1,409 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRTTI_HIERARCHY_SNAPSHOT_H
+#define MYRTTI_HIERARCHY_SNAPSHOT_H
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "myrtti/class_info.h"
+#include "myrtti/hierarchy.h"
+#include "utils/memory_usage.h"
+#include "utils/span.h"
+
+#include "append_array.h"
+#include "compressed_sets.h"
+
+namespace myrtti {
+
+struct HierarchyImage;
+
+/// @brief Registry compiled into flat arrays.
+/// Relations are stored CSR-style: items of class i are
+/// items[begins[i] .. begins[i + 1]).
+///
+/// Arrays are either views of Tables, which are shared by all computed
+/// snapshots, or mapped from binary image written by previous run (see
+/// HierarchyImage).
+struct Hierarchy::Snapshot {
+    using index_t = uint32_t;
+    using indices_t = std::vector<index_t>;
+
+    static constexpr index_t no_index = std::numeric_limits<index_t>::max();
+
+    /// @brief Slot of id -> index open addressing table.
+    /// Slots are filled in place while older snapshots read them, hence
+    /// atomics. They have the same layout as plain integers, so image
+    /// stores them as is.
+    struct Slot {
+        std::atomic<uint64_t> id{0};
+        std::atomic<index_t> index{no_index};
+        uint32_t reserved = 0;
+    };
+
+    static_assert(sizeof(Slot) == 16);
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+    static_assert(sizeof(std::atomic<index_t>) == sizeof(index_t));
+    static_assert(std::atomic<index_t>::is_always_lock_free);
+
+    /// @brief Open addressing table with linear probing, capacity is
+    /// power of 2 and at least twice bigger than amount of items.
+    /// Once it is exhausted, items are moved to twice bigger table,
+    /// previous one is retained for snapshots which refer it.
+    struct SlotTable {
+        /// @brief Makes room for given amount of items.
+        void reserve(std::size_t size);
+
+        /// @return heap memory taken by current and retained tables.
+        std::size_t memoryUsage() const;
+
+        span<Slot> slots;
+        uint64_t mask = 0;
+
+    private:
+        std::vector<std::unique_ptr<Slot[]>> tables;
+
+        /// @brief Total capacity of tables.
+        std::size_t allocated = 0;
+    };
+
+    /// @brief Tables computed snapshots are views of. Each publication
+    /// extends them with classes registered since previous one, so it
+    /// costs in proportion to amount of new classes and their ancestors,
+    /// rather than to amount of all classes.
+    ///
+    /// Tables are shared by all snapshots: arrays are only appended (see
+    /// AppendArray), and items updated in place (slots and same name
+    /// chains) are atomic. Items appended after snapshot has been taken
+    /// refer indices past the end of its classes, and snapshot skips them.
+    struct Tables {
+        /// @param base snapshot tables start with (e.g. one mapped from
+        ///        image), nullptr to start from scratch.
+        explicit Tables(const Snapshot* base);
+
+        /// @brief Appends classes past the ones tables have already.
+        void extend(span<const ClassInfo* const> classes);
+
+        /// @return heap memory taken by tables, including buffers
+        ///         retained for older snapshots.
+        std::size_t memoryUsage() const;
+
+        AppendArray<const ClassInfo*> classes;
+        SlotTable slots;
+        SlotTable nameSlots;
+        AppendArray<std::atomic<index_t>> nameNext;
+        AppendArray<index_t> parentsBegin;
+        AppendArray<index_t> parents;
+        AppendArray<index_t> ancestorSets;
+        CompressedSetsBuilder sets;
+    };
+
+    /// @brief Descendants of each class, in both orders queries return
+    /// them. Registration adds class to lists of its ancestors, so
+    /// queries return ready ranges and never allocate.
+    ///
+    /// Lists are shared by all snapshots, as Tables are: class is
+    /// appended to list in place, and snapshot skips classes past the end
+    /// of its own ones. List by depth might need class in the middle,
+    /// then it is copied, and older snapshots follow prev link to the
+    /// list they have been published with. Replaced lists are retired
+    /// along with snapshots which might use them (see takeReplaced).
+    struct Descendants {
+        struct list_t {
+            /// @brief Generation of the first snapshot which sees list.
+            uint64_t generation = 0;
+
+            /// @brief List snapshots published before see.
+            const list_t* prev = nullptr;
+
+            /// @brief Classes along with their distances from list
+            /// owner, in registration order or by distance.
+            std::unique_ptr<const ClassInfo*[]> items;
+            std::unique_ptr<index_t[]> depths;
+            std::size_t capacity = 0;
+            std::atomic<index_t> size{0};
+
+            /// @return heap memory taken by list.
+            std::size_t memoryUsage() const {
+                return sizeof(*this) + capacity * (sizeof(items[0]) + sizeof(depths[0]));
+            }
+        };
+
+        Descendants() = default;
+        Descendants(const Descendants&) = delete;
+        Descendants& operator=(const Descendants&) = delete;
+        ~Descendants();
+
+        /// @brief Adds class to lists of its ancestors.
+        /// @param generation generation of the first snapshot which
+        ///        should see class.
+        void add(const ClassInfo* cls, uint64_t generation);
+
+        /// @return lists replaced since previous call, snapshots which
+        ///         have been published before might still use them.
+        std::vector<std::unique_ptr<list_t>> takeReplaced() { return std::move(replaced); }
+
+        /// @return heap memory taken by current lists.
+        std::size_t memoryUsage() const;
+
+        /// @brief Current lists by class index, [byDepth][class].
+        AppendArray<std::atomic<list_t*>> lists[2];
+
+    private:
+        /// @return distance from ancestor to class, no_index if class
+        ///         doesn't derive it.
+        index_t depthOf(const ClassInfo* ancestor, const ClassInfo* cls) const;
+
+        /// @brief Puts class to list, by distance if byDepth is true,
+        /// otherwise to the end.
+        void insert(
+            std::atomic<list_t*>& head, const ClassInfo* cls, index_t depth,
+            bool byDepth, uint64_t generation
+        );
+
+        std::vector<std::unique_ptr<list_t>> replaced;
+    };
+
+    uint64_t generation = 0;
+
+    /// @brief Classes by dense index, nullptr for removed classes.
+    span<const ClassInfo* const> classes;
+
+    /// @brief Table with linear probing, capacity is power of 2 and
+    /// at least twice bigger than amount of classes.
+    span<const Slot> slots;
+    uint64_t slotsMask = 0;
+
+    /// @brief Name hash -> index table, same layout as id one. It refers
+    /// the first class of given name, nameNext refers the next one.
+    span<const Slot> nameSlots;
+    uint64_t nameSlotsMask = 0;
+    span<const std::atomic<index_t>> nameNext;
+
+    /// @brief Direct parents, in inheritance order.
+    span<const index_t> parentsBegin;
+    span<const index_t> parents;
+
+    /// @brief All ancestors of class i are ancestors set ancestorSets[i].
+    /// Sets are compressed, and classes with the same ancestors (e.g.
+    /// siblings with single parent) share the same set, so the whole
+    /// thing grows nearly linearly with amount of classes.
+    span<const index_t> ancestorSets;
+    compressed_sets_t ancestors;
+
+    /// @brief Descendants lists by class index, [byDepth][class].
+    span<const std::atomic<Descendants::list_t*>> descendants[2];
+
+    /// @brief Downward relations. They are needed only to save image,
+    /// so computed snapshot builds them on first request.
+    struct Derived {
+        /// @brief Direct children, in registration order.
+        span<const index_t> childrenBegin;
+        span<const index_t> children;
+
+        /// @brief Storage of children computed from parents.
+        indices_t computedBegin;
+        indices_t computed;
+    };
+
+    /// @brief Computes snapshot of given classes.
+    /// @param tables tables computed for prefix of given classes, they
+    ///        are extended, so only classes registered after previous
+    ///        snapshot are processed.
+    /// @param descendants lists of given classes.
+    Snapshot(
+        uint64_t generation,
+        const std::vector<const ClassInfo*>& classes,
+        Tables& tables,
+        const Descendants& descendants
+    );
+
+    /// @brief Creates snapshot over image arrays, image should match
+    /// given classes (see HierarchyImage::matches).
+    Snapshot(
+        uint64_t generation,
+        const std::vector<const ClassInfo*>& classes,
+        std::shared_ptr<const HierarchyImage> image,
+        const Descendants& descendants
+    );
+
+    ~Snapshot();
+
+    /// @brief Writes snapshot as binary image, see HierarchyImage.
+    void save(std::ostream& s) const;
+
+    /// @return memory taken by snapshot itself and by its downward
+    ///         relations, tables, descendants and image are accounted
+    ///         separately.
+    std::size_t memoryUsage() const;
+
+    /// @return image snapshot is created over, or nullptr.
+    const HierarchyImage* getImage() const { return image.get(); }
+
+    index_t find(class_id_t clsid) const {
+        for (std::size_t s = clsid.value & slotsMask;; s = (s + 1) & slotsMask) {
+            const Slot& slot = slots[s];
+            index_t i = slot.index.load(std::memory_order_relaxed);
+            if (i == no_index)
+                return no_index;
+            // Slots of classes registered after snapshot are skipped.
+            if (i < classes.size() && slot.id.load(std::memory_order_relaxed) == clsid.value)
+                return i;
+        }
+    }
+
+    const ClassInfo* getClassInfo(class_id_t clsid) const {
+        index_t i = find(clsid);
+        return i != no_index ? classes[i] : nullptr;
+    }
+
+    index_t findByName(const class_name_t& name) const {
+        for (std::size_t s = name.hash & nameSlotsMask;; s = (s + 1) & nameSlotsMask) {
+            const Slot& slot = nameSlots[s];
+            index_t i = slot.index.load(std::memory_order_relaxed);
+            if (i == no_index)
+                return no_index;
+            if (i < classes.size()
+                && slot.id.load(std::memory_order_relaxed) == name.hash
+                && name.name == classes[i]->name)
+                return i;
+        }
+    }
+
+    /// @return next class of the same name, chains go in registration
+    ///         order.
+    index_t nextByName(index_t i) const {
+        index_t next = nameNext[i].load(std::memory_order_relaxed);
+        return next < classes.size() ? next : no_index;
+    }
+
+    const ClassInfo* getClassInfo(const class_name_t& name) const {
+        index_t i = findByName(name);
+        return i != no_index && nextByName(i) == no_index ? classes[i] : nullptr;
+    }
+
+    std::vector<const ClassInfo*> getClassesByName(const class_name_t& name) const;
+
+    bool isParent(class_id_t child, class_id_t parent) const;
+
+    std::vector<const ClassInfo*> commonAncestors(span<const class_id_t> ids) const;
+
+    span<const ClassInfo* const> getDescendants(class_id_t clsid, bool byDepth) const;
+
+private:
+    /// @return downward relations, built on first call.
+    const Derived& derived() const;
+
+    mutable std::atomic<const Derived*> derivedRelations{nullptr};
+    std::shared_ptr<const HierarchyImage> image;
+
+    /// @brief Classes of image snapshot.
+    std::vector<const ClassInfo*> imageClasses;
+};
+
+/// @brief Binary image of Hierarchy::Snapshot, mapped read-only.
+///
+/// Image is a header followed by flat arrays of snapshot, each aligned
+/// to 8 bytes. Arrays are stored as is, in native byte order, so image
+/// is valid only for the same platform. Besides snapshot arrays image
+/// contains class ids and names, so it could be validated against
+/// registered classes.
+struct HierarchyImage {
+    using index_t = Hierarchy::Snapshot::index_t;
+    using Slot = Hierarchy::Snapshot::Slot;
+
+    static constexpr uint32_t version = 3;
+
+    enum section_t {
+        section_ids,
+        section_name_offsets,
+        section_names,
+        section_slots,
+        section_name_slots,
+        section_name_next,
+        section_parents_begin,
+        section_parents,
+        section_ancestor_sets,
+        section_sets_begin,
+        section_set_containers,
+        section_set_pool,
+        section_children_begin,
+        section_children,
+        num_sections
+    };
+
+    struct header_t {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t numClasses;
+        uint32_t numSets;
+        uint64_t slotsMask;
+        uint64_t nameSlotsMask;
+        struct {
+            uint64_t offset;
+            uint64_t size;
+        } sections[num_sections];
+    };
+
+    /// @brief Maps image file.
+    /// @return image, or nullptr if file doesn't exist or it is not
+    ///         a valid image.
+    static std::shared_ptr<const HierarchyImage> map(const std::string& path);
+
+    ~HierarchyImage();
+
+    HierarchyImage(const HierarchyImage&) = delete;
+    HierarchyImage& operator=(const HierarchyImage&) = delete;
+
+    /// @return amount of classes in image.
+    std::size_t size() const { return header->numClasses; }
+
+    /// @return image size in bytes.
+    std::size_t bytes() const { return length; }
+
+    /// @brief Checks if class with given dense index is the same as
+    /// one in image: it has the same id, name and parents.
+    bool matches(index_t i, const ClassInfo* cls) const;
+
+    template<typename T>
+    span<const T> get(section_t section) const {
+        const auto& s = header->sections[section];
+        return {reinterpret_cast<const T*>(data + s.offset), std::size_t(s.size)};
+    }
+
+    const header_t* header = nullptr;
+
+private:
+    HierarchyImage() = default;
+
+    /// @brief Checks sections bounds and relations consistency.
+    bool validate() const;
+
+    const char* data = nullptr;
+    std::size_t length = 0;
+
+    /// @brief Buffer used if mapping is not supported.
+    std::unique_ptr<uint64_t[]> buffer;
+};
+
+} // namespace myrtti
+
+#endif
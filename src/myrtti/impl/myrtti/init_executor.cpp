@@ -0,0 +1,231 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "myrtti/hierarchy.h"
+#include "myrtti/init_executor.h"
+
+namespace myrtti {
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+    using duration_t = InitExecutor::report_t::duration_t;
+
+    /// @brief Class with its tasks, and links to its direct parents and
+    /// children.
+    struct Node {
+        const ClassInfo* cls;
+        std::vector<const InitExecutor::task_t*> tasks;
+        std::vector<std::size_t> parents;
+        std::vector<std::size_t> children;
+
+        /// @brief Parents which are not done yet.
+        std::size_t pending = 0;
+
+        duration_t duration{0};
+    };
+
+    /// @brief Graph of classes, topologically ordered: parents go before
+    /// their children.
+    struct Graph {
+        std::vector<Node> nodes;
+        std::unordered_map<const ClassInfo*, std::size_t> indices;
+
+        std::size_t collect(const ClassInfo* cls) {
+            auto found = indices.find(cls);
+            if (found != end(indices))
+                return found->second;
+
+            std::vector<std::size_t> parents;
+            parents.reserve(cls->getParents().size());
+            for (std::size_t p = 0; p != cls->getParents().size(); ++p)
+                parents.push_back(collect(cls->getParentInfo(p)));
+
+            std::size_t index = nodes.size();
+            for (std::size_t p : parents)
+                nodes[p].children.push_back(index);
+
+            Node& node = nodes.emplace_back();
+            node.cls = cls;
+            node.pending = parents.size();
+            node.parents = std::move(parents);
+
+            indices.emplace(cls, index);
+            return index;
+        }
+    };
+
+    /// @brief Shared state of threads running graph.
+    struct Scheduler {
+        explicit Scheduler(Graph& graph) : graph(graph), remaining(graph.nodes.size()) {
+            for (std::size_t i = 0; i != graph.nodes.size(); ++i) {
+                if (graph.nodes[i].parents.empty())
+                    release(i);
+            }
+        }
+
+        void worker() {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (;;) {
+                wakeup.wait(lock, [&] { return failure || !remaining || !ready.empty(); });
+                if (failure || !remaining)
+                    return;
+
+                std::size_t i = ready.front();
+                ready.pop_front();
+                lock.unlock();
+
+                Node& node = graph.nodes[i];
+                auto start = clock_type::now();
+                try {
+                    for (const auto* task : node.tasks)
+                        (*task)(node.cls);
+                } catch (...) {
+                    lock.lock();
+                    if (!failure)
+                        failure = std::current_exception();
+                    wakeup.notify_all();
+                    return;
+                }
+                node.duration = clock_type::now() - start;
+
+                lock.lock();
+                done(i);
+            }
+        }
+
+        Graph& graph;
+
+        std::mutex mutex;
+        std::condition_variable wakeup;
+
+        /// @brief Nodes which tasks may run.
+        std::deque<std::size_t> ready;
+
+        /// @brief Nodes which are not done yet.
+        std::size_t remaining;
+
+        std::exception_ptr failure;
+
+    private:
+        /// @brief Node has all its parents done. Nodes without tasks
+        /// are done immediately, so readiness passes down through them.
+        void release(std::size_t i) {
+            std::vector<std::size_t> passed{i};
+            while (!passed.empty()) {
+                std::size_t n = passed.back();
+                passed.pop_back();
+
+                if (!graph.nodes[n].tasks.empty()) {
+                    ready.push_back(n);
+                    wakeup.notify_one();
+                    continue;
+                }
+
+                --remaining;
+                for (std::size_t c : graph.nodes[n].children) {
+                    if (!--graph.nodes[c].pending)
+                        passed.push_back(c);
+                }
+            }
+            if (!remaining)
+                wakeup.notify_all();
+        }
+
+        /// @brief Tasks of node are done, mutex should be held.
+        void done(std::size_t i) {
+            --remaining;
+            for (std::size_t c : graph.nodes[i].children) {
+                if (!--graph.nodes[c].pending)
+                    release(c);
+            }
+            if (!remaining)
+                wakeup.notify_all();
+        }
+    };
+}
+
+InitExecutor::InitExecutor(unsigned threads)
+: threads(threads ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+void InitExecutor::add(const ClassInfo* cls, task_t task) {
+    Hierarchy::instance()->add(cls);
+    tasks.emplace_back(cls, std::move(task));
+}
+
+InitExecutor::report_t InitExecutor::run() {
+    auto added = std::move(tasks);
+    tasks.clear();
+
+    Graph graph;
+    for (const auto& [cls, task] : added) {
+        std::size_t i = graph.collect(cls);
+        graph.nodes[i].tasks.push_back(&task);
+    }
+
+    report_t report;
+    report.tasks = added.size();
+
+    auto start = clock_type::now();
+    Scheduler scheduler(graph);
+    {
+        std::vector<std::thread> pool;
+        pool.reserve(threads - 1);
+        for (unsigned t = 1; t < threads; ++t)
+            pool.emplace_back([&] { scheduler.worker(); });
+        scheduler.worker();
+        for (auto& thread : pool)
+            thread.join();
+    }
+    report.wall = clock_type::now() - start;
+
+    if (scheduler.failure)
+        std::rethrow_exception(scheduler.failure);
+
+    // Longest path ending at each node, nodes go in topological order.
+    struct path_t {
+        duration_t duration{0};
+        std::size_t length = 0;
+    };
+    std::vector<path_t> paths(graph.nodes.size());
+    for (std::size_t i = 0; i != graph.nodes.size(); ++i) {
+        const Node& node = graph.nodes[i];
+        path_t longest;
+        for (std::size_t p : node.parents) {
+            if (paths[p].duration > longest.duration
+                || (paths[p].duration == longest.duration && paths[p].length > longest.length))
+                longest = paths[p];
+        }
+        paths[i].duration = longest.duration + node.duration;
+        paths[i].length = longest.length + node.tasks.size();
+
+        report.taskTime += node.duration;
+        if (paths[i].duration > report.criticalPath
+            || (paths[i].duration == report.criticalPath && paths[i].length > report.criticalPathLength)) {
+            report.criticalPath = paths[i].duration;
+            report.criticalPathLength = paths[i].length;
+        }
+    }
+
+    return report;
+}
+
+} // namespace myrtti
@@ -0,0 +1,174 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <mutex>
+
+#include "myrtti/instance_stats.h"
+#include "myrtti/hierarchy.h"
+#include "myrtti/runtime.h"
+
+namespace myrtti {
+
+namespace {
+    struct Registry {
+        std::mutex lock;
+
+        /// @brief Counters of running threads.
+        std::vector<details::InstanceCounters*> live;
+
+        /// @brief Counters of finished threads, summed up.
+        std::vector<int64_t> retired;
+
+        void retire(uint32_t index, int64_t delta) {
+            if (retired.size() <= index)
+                retired.resize(index + 1);
+            retired[index] += delta;
+        }
+    };
+
+    // Objects might outlive any static, so registry is never destroyed.
+    Registry& registry() {
+        static Registry* r = new Registry;
+        return *r;
+    }
+
+    /// @brief Used by threads which have finished already, but still
+    /// destroy objects (e.g. main thread destroying statics). It has no
+    /// counters, so everything goes into retired ones.
+    details::InstanceCounters orphanCounters;
+
+    /// @brief Owns thread counters, folds them into retired on thread exit.
+    struct ThreadCounters {
+        details::InstanceCounters counters;
+
+        ThreadCounters() {
+            auto& r = registry();
+            std::lock_guard<std::mutex> guard(r.lock);
+            r.live.push_back(&counters);
+        }
+
+        ~ThreadCounters() {
+            auto& r = registry();
+            {
+                std::lock_guard<std::mutex> guard(r.lock);
+                for (std::size_t i = 0; i != counters.capacity; ++i)
+                    r.retire(i, counters.counts[i].load(std::memory_order_relaxed));
+                r.live.erase(std::find(begin(r.live), end(r.live), &counters));
+            }
+            delete[] counters.counts;
+            details::threadInstanceCounters = &orphanCounters;
+        }
+    };
+
+    /// @return own live instances of classes, by dense index.
+    std::vector<int64_t> collect() {
+        auto& r = registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+
+        std::vector<int64_t> totals(r.retired);
+        for (auto* counters : r.live) {
+            if (totals.size() < counters->capacity)
+                totals.resize(counters->capacity);
+            for (std::size_t i = 0; i != counters->capacity; ++i)
+                totals[i] += counters->counts[i].load(std::memory_order_relaxed);
+        }
+        return totals;
+    }
+
+    InstanceStats::entry_t makeEntry(const ClassInfo* cls, const std::vector<int64_t>& own) {
+        auto ownOf = [&](const ClassInfo* c) {
+            return c->getIndex() < own.size() ? own[c->getIndex()] : 0;
+        };
+
+        InstanceStats::entry_t e{cls, ownOf(cls), 0, 0, 0};
+        e.bytes = e.instances * int64_t(cls->size);
+        e.totalInstances = e.instances;
+        e.totalBytes = e.bytes;
+
+        for (const ClassInfo* d : Hierarchy::instance()->descendants(cls->getId())) {
+            int64_t n = ownOf(d);
+            e.totalInstances += n;
+            e.totalBytes += n * int64_t(d->size);
+        }
+        return e;
+    }
+}
+
+namespace details {
+    InstanceCounters* attach_instance_counters() {
+        thread_local ThreadCounters counters;
+        threadInstanceCounters = &counters.counters;
+        return threadInstanceCounters;
+    }
+
+    void InstanceCounters::addSlow(const ClassInfo* cls, int64_t delta) {
+        if (!cls->isRegistered())
+            Hierarchy::instance()->add(cls);
+
+        uint32_t i = cls->getIndex();
+
+        auto& r = registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+
+        if (this == &orphanCounters) {
+            r.retire(i, delta);
+            return;
+        }
+
+        if (i >= capacity) {
+            // Readers hold the lock, so we can replace counters.
+            std::size_t newCapacity = std::max<std::size_t>(64, capacity * 2);
+            while (newCapacity <= i)
+                newCapacity *= 2;
+
+            auto* fresh = new std::atomic<int64_t>[newCapacity]();
+            for (std::size_t k = 0; k != capacity; ++k)
+                fresh[k].store(counts[k].load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+            delete[] counts;
+            counts = fresh;
+            capacity = newCapacity;
+        }
+
+        auto& c = counts[i];
+        c.store(c.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+}
+
+InstanceStats::entry_t InstanceStats::get(const ClassInfo* cls) {
+    return makeEntry(cls, collect());
+}
+
+std::vector<InstanceStats::entry_t> InstanceStats::snapshot() {
+    auto own = collect();
+
+    std::vector<entry_t> res;
+    auto addClass = [&](const ClassInfo* cls) {
+        entry_t e = makeEntry(cls, own);
+        if (e.totalInstances)
+            res.push_back(e);
+    };
+
+    addClass(Object::info());
+    for (const ClassInfo* cls : Hierarchy::instance()->descendants(Object::class_id()))
+        addClass(cls);
+
+    std::stable_sort(begin(res), end(res), [](const entry_t& l, const entry_t& r) {
+        return l.totalBytes > r.totalBytes;
+    });
+    return res;
+}
+
+} // namespace myrtti
@@ -0,0 +1,149 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+#include "myrtti/hierarchy.h"
+#include "myrtti/object_arena.h"
+#include "myrtti/runtime.h"
+
+namespace myrtti {
+
+/// @brief Fixed size blocks of one class, free blocks are linked into
+/// list through their first bytes.
+struct ObjectArena::Pool {
+    static constexpr std::size_t first_chunk = 16;
+    static constexpr std::size_t max_chunk = 4096;
+
+    Pool(std::size_t size, std::size_t alignment)
+    : alignment(std::max(alignment, alignof(void*))) {
+        blockSize = std::max(size, sizeof(void*));
+        blockSize = (blockSize + this->alignment - 1) / this->alignment * this->alignment;
+    }
+
+    ~Pool() {
+        for (void* chunk : chunks)
+            ::operator delete(chunk, std::align_val_t(alignment));
+    }
+
+    void* allocate() {
+        if (!freeList)
+            grow();
+        void* block = freeList;
+        freeList = *static_cast<void**>(block);
+        return block;
+    }
+
+    void deallocate(void* block) {
+        *static_cast<void**>(block) = freeList;
+        freeList = block;
+    }
+
+    void grow() {
+        auto* chunk = static_cast<char*>(
+            ::operator new(blockSize * chunkBlocks, std::align_val_t(alignment))
+        );
+        chunks.push_back(chunk);
+
+        for (std::size_t i = chunkBlocks; i--;)
+            deallocate(chunk + i * blockSize);
+
+        chunkBlocks = std::min(chunkBlocks * 2, max_chunk);
+    }
+
+    std::size_t alignment;
+    std::size_t blockSize;
+
+    /// @brief Offset of Object subobject, it is the same for all
+    /// objects of class, for they are complete ones.
+    std::ptrdiff_t objectOffset = -1;
+
+    std::size_t chunkBlocks = first_chunk;
+    void* freeList = nullptr;
+    std::vector<void*> chunks;
+};
+
+ObjectArena::ObjectArena() = default;
+
+ObjectArena::~ObjectArena() {
+    assert(!live && "All objects should be destroyed before arena.");
+}
+
+ObjectArena::Pool& ObjectArena::getPool(const ClassInfo* cls) {
+    if (!cls->isRegistered())
+        Hierarchy::instance()->add(cls);
+
+    uint32_t i = cls->getIndex();
+    if (i >= pools.size())
+        pools.resize(i + 1);
+
+    auto& pool = pools[i];
+    if (/* [[unlikely]] */ !pool) {
+        std::size_t alignment = cls->factory ? cls->factory->alignment : alignof(std::max_align_t);
+        pool = std::make_unique<Pool>(cls->size, alignment);
+    }
+    return *pool;
+}
+
+void* ObjectArena::allocate(const ClassInfo* cls) {
+    void* storage = getPool(cls).allocate();
+    ++live;
+    return storage;
+}
+
+void ObjectArena::deallocate(const ClassInfo* cls, void* storage) {
+    assert(cls->getIndex() < pools.size() && pools[cls->getIndex()]);
+    pools[cls->getIndex()]->deallocate(storage);
+    --live;
+}
+
+Object* ObjectArena::create(const ClassInfo* cls) {
+    if (!cls->factory)
+        return nullptr;
+
+    Pool& pool = getPool(cls);
+    void* storage = pool.allocate();
+
+    Object* o;
+    try {
+        o = cls->factory->construct(storage);
+    } catch (...) {
+        pool.deallocate(storage);
+        throw;
+    }
+
+    pool.objectOffset = reinterpret_cast<char*>(o) - static_cast<char*>(storage);
+    ++live;
+    return o;
+}
+
+void ObjectArena::destroy(Object* o) {
+    const ClassInfo* cls = o->rtti;
+    assert(cls->factory && "Object should be created by ClassInfo::createInstance.");
+    assert(cls->getIndex() < pools.size() && pools[cls->getIndex()]);
+
+    Pool& pool = *pools[cls->getIndex()];
+    void* storage = reinterpret_cast<char*>(o) - pool.objectOffset;
+    cls->factory->destroy(storage);
+    pool.deallocate(storage);
+    --live;
+}
+
+Object* ClassInfo::createInstance(ObjectArena& arena) const {
+    return arena.create(this);
+}
+
+} // namespace myrtti
@@ -0,0 +1,216 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <thread>
+
+#include "myrtti/reachability_index.h"
+
+namespace myrtti {
+
+namespace {
+    using indices_t = std::vector<uint32_t>;
+
+    constexpr uint32_t no_number = ~0u;
+
+    /// @brief Levels smaller than this are labeled by single thread.
+    constexpr std::size_t min_parallel_level = 4096;
+
+    void set_range(std::vector<uint64_t>& bits, uint32_t low, uint32_t high) {
+        for (uint32_t i = low; i <= high; ++i)
+            bits[i / 64] |= uint64_t(1) << (i % 64);
+    }
+}
+
+ReachabilityIndex::ReachabilityIndex(
+    span<const uint32_t> parentsBegin,
+    span<const uint32_t> parents,
+    unsigned threads
+) {
+    std::size_t n = parentsBegin.empty() ? 0 : parentsBegin.size() - 1;
+
+    // Children, by inverting parents.
+    indices_t childrenBegin(n + 1, 0), children(parents.size());
+    for (uint32_t p : parents)
+        ++childrenBegin[p + 1];
+    for (std::size_t i = 0; i != n; ++i)
+        childrenBegin[i + 1] += childrenBegin[i];
+    {
+        indices_t fill(begin(childrenBegin), end(childrenBegin) - 1);
+        for (uint32_t i = 0; i != n; ++i) {
+            for (uint32_t k = parentsBegin[i]; k != parentsBegin[i + 1]; ++k)
+                children[fill[parents[k]]++] = i;
+        }
+    }
+
+    // Post order of spanning forest. Nodes of tree rooted at v are
+    // numbered [low[v] .. post[v]].
+    post.assign(n, no_number);
+    indices_t low(n);
+    {
+        struct frame_t {
+            uint32_t node;
+            uint32_t next;
+        };
+        std::vector<frame_t> stack;
+        uint32_t counter = 0;
+
+        for (uint32_t r = 0; r != n; ++r) {
+            if (parentsBegin[r] != parentsBegin[r + 1])
+                continue;
+
+            low[r] = counter;
+            post[r] = 0;
+            stack.push_back({r, childrenBegin[r]});
+            while (!stack.empty()) {
+                frame_t& top = stack.back();
+                if (top.next == childrenBegin[top.node + 1]) {
+                    post[top.node] = counter++;
+                    stack.pop_back();
+                    continue;
+                }
+                uint32_t c = children[top.next++];
+                if (post[c] != no_number)
+                    continue;
+                low[c] = counter;
+                post[c] = 0;
+                stack.push_back({c, childrenBegin[c]});
+            }
+        }
+    }
+
+    // Heights, over topological order (parents first).
+    indices_t order;
+    order.reserve(n);
+    {
+        indices_t pending(n);
+        for (uint32_t i = 0; i != n; ++i) {
+            pending[i] = parentsBegin[i + 1] - parentsBegin[i];
+            if (!pending[i])
+                order.push_back(i);
+        }
+        for (std::size_t k = 0; k != order.size(); ++k) {
+            uint32_t v = order[k];
+            for (uint32_t c = childrenBegin[v]; c != childrenBegin[v + 1]; ++c) {
+                if (!--pending[children[c]])
+                    order.push_back(children[c]);
+            }
+        }
+    }
+
+    indices_t height(n, 0);
+    std::vector<indices_t> levels;
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        uint32_t v = *it;
+        for (uint32_t c = childrenBegin[v]; c != childrenBegin[v + 1]; ++c)
+            height[v] = std::max(height[v], height[children[c]] + 1);
+        if (levels.size() <= height[v])
+            levels.resize(height[v] + 1);
+        levels[height[v]].push_back(v);
+    }
+
+    // Labels, merged from children ones.
+    std::size_t words = (n + 63) / 64;
+    std::vector<std::vector<interval_t>> nodeIntervals(n);
+    std::vector<std::vector<uint64_t>> nodeBits(n);
+
+    auto label = [&](uint32_t v) {
+        auto kids = span<const uint32_t>(
+            children.data() + childrenBegin[v], childrenBegin[v + 1] - childrenBegin[v]
+        );
+
+        bool bitset = std::any_of(begin(kids), end(kids), [&](uint32_t c) {
+            return !nodeBits[c].empty();
+        });
+
+        if (!bitset) {
+            std::vector<interval_t>& res = nodeIntervals[v];
+            res.push_back({low[v], post[v]});
+            for (uint32_t c : kids)
+                res.insert(end(res), begin(nodeIntervals[c]), end(nodeIntervals[c]));
+            std::sort(begin(res), end(res), [](const interval_t& a, const interval_t& b) {
+                return a.low < b.low;
+            });
+
+            std::size_t last = 0;
+            for (std::size_t i = 1; i != res.size(); ++i) {
+                if (res[i].low <= res[last].high + 1)
+                    res[last].high = std::max(res[last].high, res[i].high);
+                else
+                    res[++last] = res[i];
+            }
+            res.resize(last + 1);
+
+            if (res.size() * sizeof(interval_t) <= words * sizeof(uint64_t))
+                return;
+        }
+
+        std::vector<uint64_t>& res = nodeBits[v];
+        res.assign(words, 0);
+        for (const interval_t& i : nodeIntervals[v])
+            set_range(res, i.low, i.high);
+        set_range(res, low[v], post[v]);
+        for (uint32_t c : kids) {
+            for (const interval_t& i : nodeIntervals[c])
+                set_range(res, i.low, i.high);
+            for (std::size_t w = 0; w != nodeBits[c].size(); ++w)
+                res[w] |= nodeBits[c][w];
+        }
+        nodeIntervals[v].clear();
+        nodeIntervals[v].shrink_to_fit();
+    };
+
+    // Nodes of one level depend on lower levels only.
+    for (const indices_t& level : levels) {
+        unsigned workers = level.size() >= min_parallel_level ? threads : 1;
+        if (workers <= 1) {
+            for (uint32_t v : level)
+                label(v);
+            continue;
+        }
+
+        std::vector<std::thread> pool;
+        std::size_t chunk = (level.size() + workers - 1) / workers;
+        for (std::size_t first = 0; first < level.size(); first += chunk) {
+            std::size_t last = std::min(first + chunk, level.size());
+            pool.emplace_back([&, first, last] {
+                for (std::size_t k = first; k != last; ++k)
+                    label(level[k]);
+            });
+        }
+        for (auto& t : pool)
+            t.join();
+    }
+
+    // Flat arrays, so queries touch few cache lines.
+    labels.resize(n);
+    for (uint32_t v = 0; v != n; ++v) {
+        if (!nodeBits[v].empty()) {
+            labels[v] = {kind_bitset, uint32_t(words), bits.size()};
+            bits.insert(end(bits), begin(nodeBits[v]), end(nodeBits[v]));
+        } else {
+            labels[v] = {kind_intervals, uint32_t(nodeIntervals[v].size()), intervals.size()};
+            intervals.insert(end(intervals), begin(nodeIntervals[v]), end(nodeIntervals[v]));
+        }
+    }
+}
+
+std::size_t ReachabilityIndex::memoryUsage() const {
+    return post.capacity() * sizeof(uint32_t)
+        + labels.capacity() * sizeof(label_t)
+        + intervals.capacity() * sizeof(interval_t)
+        + bits.capacity() * sizeof(uint64_t);
+}
+
+} // namespace myrtti
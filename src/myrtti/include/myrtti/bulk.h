@@ -0,0 +1,270 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRTTI_BULK_H
+#define MYRTTI_BULK_H
+
+#include "myrtti/runtime.h"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace myrtti
+{
+namespace details {
+    /// @brief Cross pointers captured from a prototype object.
+    /// Pointers are kept as offsets from Object subobject, which are the
+    /// same for all complete objects of the same class.
+    struct CrossPtrsLayout {
+        /// @param storage storage prototype is constructed in
+        /// @param prototype complete object
+        CrossPtrsLayout(const void* storage, const Object& prototype)
+        : objectOffset(
+            reinterpret_cast<const char*>(&prototype) - static_cast<const char*>(storage)
+        ) {
+            auto* base = reinterpret_cast<const char*>(&prototype);
+            entries.reserve(prototype.crossPtrs.size());
+            for (const auto& [id, ptr] : prototype.crossPtrs) {
+                if (id != Object::class_id())
+                    entries.emplace_back(id, static_cast<const char*>(ptr) - base);
+            }
+        }
+
+        /// @return address Object subobject of object constructed in
+        ///         given storage will have.
+        const Object* objectAt(const void* storage) const {
+            return reinterpret_cast<const Object*>(
+                static_cast<const char*>(storage) + objectOffset
+            );
+        }
+
+        /// @brief Fills crossPtrs of object constructed in stamp mode.
+        void stamp(Object& o) const {
+            auto* base = reinterpret_cast<char*>(&o);
+            for (const auto& [id, offset] : entries)
+                o.crossPtrs.emplace_hint(end(o.crossPtrs), id, base + offset);
+        }
+
+        /// @brief Fills crossPtrs of object copied from another one,
+        /// copied pointers still point to subobjects of source.
+        void rebind(Object& o) const {
+            o.crossPtrs.clear();
+            o.crossPtrs.emplace(Object::class_id(), &o);
+            stamp(o);
+        }
+
+    private:
+        std::ptrdiff_t objectOffset;
+        std::vector<std::pair<class_id_t, std::ptrdiff_t>> entries;
+    };
+
+    /// @brief Sets stamped object for current thread, restores previous
+    /// one on exit, so construct_n may be nested into constructors.
+    struct StampScope {
+        explicit StampScope(const Object* object) : prev(stampedObject) {
+            stampedObject = object;
+        }
+        ~StampScope() { stampedObject = prev; }
+    private:
+        const Object* prev;
+    };
+}
+
+/// @brief Destroys n objects constructed by construct_n, last to first.
+template<class T>
+void destroy_n(T* first, std::size_t n) {
+    while (n)
+        first[--n].~T();
+}
+
+/// @brief Constructs n objects of T in contiguous storage.
+///
+/// The first object is constructed as usual and serves as a prototype:
+/// its cross pointers layout is captured once, and then stamped into
+/// each subsequent object, so RTTI constructors don't touch crossPtrs
+/// level by level. Only object being stamped skips them: its members and
+/// other objects created by its constructor are constructed as usual.
+/// Object's own cross pointers are stamped once its constructor returns,
+/// so constructor shouldn't cast object itself.
+///
+/// If any constructor throws, already constructed objects are destroyed
+/// and exception is propagated.
+///
+/// @param storage memory suitable for n objects of T
+/// @param n amount of objects
+/// @param args arguments passed to each constructor, as lvalues
+/// @return pointer to the first object
+template<class T, class ...Args>
+T* construct_n(void* storage, std::size_t n, Args&&... args) {
+    static_assert(std::is_base_of_v<Object, T>, "T must be a myrtti class.");
+
+    T* objects = static_cast<T*>(storage);
+    if (!n)
+        return objects;
+
+    new (objects) T(args...);
+
+    std::size_t constructed = 1;
+    try {
+        details::CrossPtrsLayout layout(objects, objects[0]);
+
+        for (; constructed != n; ++constructed) {
+            T* o;
+            {
+                details::StampScope scope(layout.objectAt(objects + constructed));
+                o = new (objects + constructed) T(args...);
+            }
+            layout.stamp(*o);
+        }
+    } catch (...) {
+        destroy_n(objects, constructed);
+        throw;
+    }
+
+    return objects;
+}
+
+/// @brief Batch of n objects of T, placed contiguously in one block.
+/// Keeps objects alive until batch is destroyed, block is released
+/// with allocator it has been obtained from.
+template<class T, class Alloc = std::allocator<T>>
+struct ObjectBatch {
+    using alloc_traits_t = std::allocator_traits<Alloc>;
+
+    ObjectBatch() = default;
+
+    ObjectBatch(T* objects, std::size_t n, const Alloc& alloc = Alloc())
+    : alloc(alloc), objects(objects), n(n) {}
+
+    ObjectBatch(ObjectBatch&& src) noexcept
+    : alloc(src.alloc),
+      objects(std::exchange(src.objects, nullptr)), n(std::exchange(src.n, 0)) {}
+
+    /// @brief Releases current objects with own allocator, then takes
+    /// block of src if allocator propagates or allocators are equal.
+    /// Otherwise objects of src are moved one by one into block of own
+    /// allocator, the way containers do.
+    ObjectBatch& operator=(ObjectBatch&& src) noexcept(
+        alloc_traits_t::propagate_on_container_move_assignment::value
+        || alloc_traits_t::is_always_equal::value
+    ) {
+        if (this == &src)
+            return *this;
+
+        release();
+        if constexpr (alloc_traits_t::propagate_on_container_move_assignment::value) {
+            alloc = std::move(src.alloc);
+            take(src);
+        } else if (alloc_traits_t::is_always_equal::value || alloc == src.alloc) {
+            take(src);
+        } else {
+            moveElements(src);
+        }
+        return *this;
+    }
+
+    ~ObjectBatch() { release(); }
+
+    T* begin() const { return objects; }
+    T* end() const { return objects + n; }
+    T* data() const { return objects; }
+    std::size_t size() const { return n; }
+    T& operator[](std::size_t i) const { return objects[i]; }
+
+private:
+    Alloc alloc;
+    T* objects = nullptr;
+    std::size_t n = 0;
+
+    void release() {
+        if (!objects)
+            return;
+        destroy_n(objects, n);
+        alloc_traits_t::deallocate(alloc, objects, n);
+        objects = nullptr;
+        n = 0;
+    }
+
+    void take(ObjectBatch& src) {
+        objects = std::exchange(src.objects, nullptr);
+        n = std::exchange(src.n, 0);
+    }
+
+    /// @brief Moves objects of src into new block, src is released.
+    /// Cross pointers of moved objects are rebound with layout of src.
+    void moveElements(ObjectBatch& src) {
+        if (!src.objects)
+            return;
+
+        T* storage = alloc_traits_t::allocate(alloc, src.n);
+        std::size_t constructed = 0;
+        try {
+            details::CrossPtrsLayout layout(src.objects, src.objects[0]);
+            for (; constructed != src.n; ++constructed) {
+                T* o = new (storage + constructed) T(std::move(src.objects[constructed]));
+                layout.rebind(*o);
+            }
+        } catch (...) {
+            destroy_n(storage, constructed);
+            alloc_traits_t::deallocate(alloc, storage, src.n);
+            throw;
+        }
+
+        objects = storage;
+        n = src.n;
+        src.release();
+    }
+};
+
+/// @brief Allocates single block of n objects of T with given allocator
+/// and constructs objects in it, see construct_n. Allocator might be
+/// backed by arena, e.g. std::pmr::polymorphic_allocator over
+/// std::pmr::monotonic_buffer_resource, so that batches allocated
+/// together are placed together.
+/// @param alloc allocator of T, batch keeps its copy to release block
+/// @param n amount of objects
+/// @param args arguments passed to each constructor, as lvalues
+template<class T, class Alloc, class ...Args>
+ObjectBatch<T, Alloc> make_many(
+    std::allocator_arg_t, const Alloc& alloc, std::size_t n, Args&&... args
+) {
+    static_assert(
+        std::is_same_v<typename std::allocator_traits<Alloc>::value_type, T>,
+        "Allocator should allocate objects of T."
+    );
+
+    Alloc a(alloc);
+    T* storage = std::allocator_traits<Alloc>::allocate(a, n);
+    try {
+        return ObjectBatch<T, Alloc>(construct_n<T>(storage, n, args...), n, a);
+    } catch (...) {
+        std::allocator_traits<Alloc>::deallocate(a, storage, n);
+        throw;
+    }
+}
+
+/// @brief Allocates single block on heap and constructs n objects of T
+/// in it, see construct_n.
+template<class T, class ...Args>
+ObjectBatch<T> make_many(std::size_t n, Args&&... args) {
+    return make_many<T>(std::allocator_arg, std::allocator<T>(), n, args...);
+}
+
+} // namespace myrtti
+
+#endif
@@ -0,0 +1,183 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRTTI_CAST_LAYOUT_H
+#define MYRTTI_CAST_LAYOUT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "myrtti/class_id.h"
+
+namespace myrtti {
+
+struct CastProfile;
+
+/// @brief Per-class cast lookup table, built from a cast profile.
+///
+/// Table contains hottest cast targets of particular class. Entries are
+/// stored hottest first, and slot for each target is resolved through
+/// a perfect hash (seed is chosen when table is built), so lookup is
+/// a single probe with no collisions.
+///
+/// For each target table learns an offset from Object subobject to
+/// target subobject. Offsets are learned at runtime during first
+/// successful lookup in object's crossPtrs, and then applied to all objects
+/// of the same dynamic type (checked by vptr).
+struct CastTable {
+    /// @brief Offset is not learned yet.
+    static constexpr std::ptrdiff_t unknown_offset = PTRDIFF_MIN;
+    /// @brief Target is not a base of the class.
+    static constexpr std::ptrdiff_t not_a_base = PTRDIFF_MAX;
+
+    static constexpr uint8_t empty_slot = 0xff;
+
+    struct entry_t {
+        class_id_t target{""};
+        uint64_t count = 0;
+
+        /// Vptr of the object offset has been learned for.
+        mutable std::atomic<const void*> vptr{nullptr};
+        mutable std::atomic<std::ptrdiff_t> offset{unknown_offset};
+
+        /// @brief Saves offset for given dynamic type. Only the first
+        /// learn call succeeds, so (vptr, offset) pair always stays
+        /// consistent.
+        void learn(const void* objVptr, std::ptrdiff_t objOffset) const {
+            const void* expected = nullptr;
+            if (vptr.compare_exchange_strong(expected, objVptr, std::memory_order_acq_rel))
+                offset.store(objOffset, std::memory_order_release);
+        }
+    };
+
+    /// @brief Builds table for given targets.
+    /// @param cls class table is built for
+    /// @param targets targets, hottest first
+    /// @param counts cast counts for each target
+    /// @param seed perfect hash seed
+    /// @param bits log2 of slots amount
+    /// @throw std::runtime_error if seed produces collisions.
+    CastTable(
+        class_id_t cls,
+        const std::vector<class_id_t>& targets,
+        const std::vector<uint64_t>& counts,
+        uint64_t seed,
+        unsigned bits
+    );
+
+    /// @brief Picks a seed which places all targets into distinct slots.
+    /// @param targets targets to be hashed
+    /// @param [out] seed picked seed
+    /// @param [out] bits log2 of slots amount
+    static void pickSeed(
+        const std::vector<class_id_t>& targets, uint64_t& seed, unsigned& bits
+    );
+
+    static constexpr std::size_t slotOf(class_id_t target, uint64_t seed, unsigned bits) {
+        return static_cast<std::size_t>(
+            ((target.value ^ seed) * 0x9e3779b97f4a7c15ull) >> (64 - bits)
+        );
+    }
+
+    /// @brief Looks up entry for given target.
+    /// @return entry or nullptr if target is not in table.
+    const entry_t* find(class_id_t target) const {
+        uint8_t e = slots[slotOf(target, seed, bits)];
+        if (e == empty_slot || entries[e].target != target)
+            return nullptr;
+        return &entries[e];
+    }
+
+    class_id_t getId() const { return cls; }
+    uint64_t getSeed() const { return seed; }
+    unsigned getBits() const { return bits; }
+    std::size_t size() const { return numEntries; }
+    const entry_t& operator[](std::size_t i) const { return entries[i]; }
+
+private:
+    class_id_t cls;
+    uint64_t seed;
+    unsigned bits;
+    std::size_t numEntries;
+    std::unique_ptr<entry_t[]> entries;
+    std::unique_ptr<uint8_t[]> slots;
+};
+
+namespace details {
+    /// @brief Marks cast which uses cast table. Layout replaced by
+    /// Hierarchy::setCastLayout is released only once casts started
+    /// before replacement are finished (see Hierarchy epochs).
+    struct CastTableGuard {
+        CastTableGuard();
+        ~CastTableGuard();
+
+        CastTableGuard(const CastTableGuard&) = delete;
+        CastTableGuard& operator=(const CastTableGuard&) = delete;
+    };
+}
+
+/// @brief Set of per-class cast tables, the second half of profile-guided
+/// cast layout.
+///
+/// Layout is built offline from profile (see `myrtti_profdata` tool) and
+/// stored as a plain text:
+///
+///     # myrtti cast layout v1
+///     class <class id> <seed> <bits> <targets amount>
+///         <target id> <count>
+///         ...
+///
+/// Seeds are stored in layout, so loading it doesn't involve any search.
+/// Layout can be loaded at startup, or baked into the binary with header
+/// emitted by `myrtti_profdata header`.
+///
+/// Tables are applied by Hierarchy::setCastLayout. Casts use them only
+/// when MYRTTI_CAST_LAYOUT is defined.
+struct CastLayout {
+    /// @brief Max amount of targets per class, only hottest ones are kept.
+    static constexpr std::size_t max_targets = 32;
+
+    /// @brief Builds layout from profile.
+    static std::shared_ptr<CastLayout> build(const CastProfile& profile);
+
+    /// @brief Loads text layout.
+    /// @throw std::runtime_error if input is malformed.
+    static std::shared_ptr<CastLayout> load(std::istream& s);
+
+    /// @brief Writes layout in text format.
+    void save(std::ostream& s) const;
+
+    /// @brief Writes C++ header which bakes layout into the build.
+    void emitHeader(std::ostream& s) const;
+
+    /// @return table for given class or nullptr.
+    const CastTable* find(class_id_t cls) const;
+
+    std::size_t size() const { return tables.size(); }
+
+private:
+    std::vector<std::unique_ptr<CastTable>> tables;
+    std::unordered_map<class_id_t, const CastTable*> index;
+
+    void addTable(std::unique_ptr<CastTable> table);
+};
+
+} // namespace myrtti
+
+#endif
@@ -0,0 +1,100 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRTTI_CAST_PROFILE_H
+#define MYRTTI_CAST_PROFILE_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "myrtti/class_id.h"
+
+namespace myrtti {
+
+struct ClassInfo;
+
+/// @brief Collects (from class, to class, count) triples for casts.
+///
+/// This is the first half of profile-guided cast layout. Instrumented
+/// builds (MYRTTI_CAST_PROFILE defined, e.g. `myrtti_profile` target)
+/// record every dyn_cast, try_static_cast and Visitor::visit cast into
+/// CastProfile::instance(), which is written on process exit into
+/// file given by MYRTTI_PROFILE_FILE environment variable
+/// (`myrtti.profile` by default).
+///
+/// Profile file is a plain text, one triple per line:
+///
+///     # myrtti cast profile v1
+///     <from id> <to id> <count> <from name> <to name>
+///
+struct CastProfile {
+
+    struct entry_t {
+        class_id_t from;
+        class_id_t to;
+        uint64_t count;
+        std::string fromName;
+        std::string toName;
+    };
+
+    CastProfile();
+    ~CastProfile();
+
+    CastProfile(const CastProfile&) = delete;
+    CastProfile& operator=(const CastProfile&) = delete;
+
+    /// @brief Records single cast. Thread safe, each thread owns its
+    /// own counters shard, so threads don't contend for the same lock.
+    /// @param from class of object which is being casted
+    /// @param to cast target class
+    void record(const ClassInfo* from, const ClassInfo* to);
+
+    /// @brief Adds count to given (from, to) pair.
+    void add(const entry_t& entry);
+
+    /// @brief Adds all triples from another profile.
+    void merge(const CastProfile& src);
+
+    /// @return all collected triples, hottest first.
+    std::vector<entry_t> entries() const;
+
+    /// @brief Writes profile in text format.
+    void save(std::ostream& s) const;
+
+    /// @brief Reads text profile and merges it into this one.
+    /// @throw std::runtime_error if input is malformed.
+    void load(std::istream& s);
+
+    /// @brief Process wide profile, instrumented casts are recorded here.
+    static CastProfile* instance();
+
+private:
+    struct shard_t;
+
+    shard_t* threadShard();
+
+    /// Unique profile number, identifies profile in threads shard caches.
+    const uint64_t serial;
+
+    mutable std::mutex shardsLock;
+    std::vector<std::unique_ptr<shard_t>> shards;
+};
+
+} // namespace myrtti
+
+#endif
@@ -15,7 +15,9 @@
 #ifndef RTTI_CLASS_ID_H
 #define RTTI_CLASS_ID_H
 
+#include <cstdint>
 #include <iosfwd>
+#include <type_traits>
 #include <utility>
 #include "crc/crc.hpp"
 
@@ -23,16 +25,115 @@ namespace myrtti {
 
 using CRC = crc::CRC64;
 
+/// @brief Hash policies for class ids.
+///
+/// Policy is a default constructible type with constexpr
+/// operator()(const char* name, Args... d), which hashes class name along
+/// with C strings and integers passed in d.
+///
+/// Ids are computed during compilation for every RTTI class, so the
+/// policy cost shows up in build times. Ids also make their way into
+/// hierarchy images and cast profiles, thus all parts of program as well
+/// as stored data should use the same policy.
+namespace id_hash {
+
+/// @brief CRC-64-ECMA over all bytes of arguments, the default one.
+/// Arguments are hashed as one continuous stream, so ("ab", "c") and
+/// ("abc") give the same id.
+struct crc64 {
+    template<typename ...Args>
+    constexpr uint64_t operator()(const char* className, const Args&... d) const noexcept {
+        constexpr CRC engine;
+        return engine(className, d...);
+    }
+};
+
+/// @brief wyhash-like hash, which consumes input by 8 byte words and
+/// mixes each pair of words with single 64x64->128 multiplication.
+/// It takes several times less constexpr evaluation steps than crc64.
+///
+/// Each argument is hashed separately and combined with the rest, so
+/// unlike crc64 ("ab", "c") and ("abc") are different ids.
+struct wyhash {
+    template<typename ...Args>
+    constexpr uint64_t operator()(const char* className, const Args&... d) const noexcept {
+        uint64_t seed = add(secret[0], className);
+        ((seed = add(seed, d)), ...);
+        return mix(seed ^ secret[0], seed ^ secret[3]);
+    }
+
+private:
+    static constexpr uint64_t secret[4] = {
+        0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+        0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull
+    };
+
+    /// @brief Folded 128-bit product of a and b, computed with 32-bit
+    /// halves, for there is no portable 128-bit integer.
+    static constexpr uint64_t mix(uint64_t a, uint64_t b) noexcept {
+        uint64_t aLo = uint32_t(a), aHi = a >> 32;
+        uint64_t bLo = uint32_t(b), bHi = b >> 32;
+
+        uint64_t ll = aLo * bLo, lh = aLo * bHi, hl = aHi * bLo, hh = aHi * bHi;
+        uint64_t mid = (ll >> 32) + uint32_t(lh) + uint32_t(hl);
+
+        uint64_t lo = (mid << 32) | uint32_t(ll);
+        uint64_t hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+        return lo ^ hi;
+    }
+
+    /// @brief Reads up to 8 bytes as little endian word.
+    static constexpr uint64_t read(const char* p, std::size_t n) noexcept {
+        uint64_t v = 0;
+        for (std::size_t i = 0; i != n; ++i)
+            v |= uint64_t(uint8_t(p[i])) << (i * 8);
+        return v;
+    }
+
+    static constexpr uint64_t add(uint64_t seed, const char* str) noexcept {
+        std::size_t len = 0;
+        while (str[len])
+            ++len;
+
+        seed ^= mix(seed ^ secret[0], len ^ secret[1]);
+
+        const char* p = str;
+        std::size_t left = len;
+        for (; left > 16; p += 16, left -= 16)
+            seed = mix(read(p, 8) ^ secret[1], read(p + 8, 8) ^ seed);
+
+        uint64_t a = read(p, left < 8 ? left : 8);
+        uint64_t b = left > 8 ? read(p + 8, left - 8) : 0;
+        return mix(a ^ secret[1], b ^ seed);
+    }
+
+    template<typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+    static constexpr uint64_t add(uint64_t seed, T v) noexcept {
+        return mix(uint64_t(v) ^ secret[2], seed ^ secret[1]);
+    }
+};
+
+} // namespace id_hash
+
+/// @brief Hash policy class ids are made with. It can be overridden by
+/// defining MYRTTI_CLASS_ID_HASH (see CMake option of the same name) as
+/// one of id_hash policies or any other type with same interface.
+#ifdef MYRTTI_CLASS_ID_HASH
+using class_id_hash = MYRTTI_CLASS_ID_HASH;
+#else
+using class_id_hash = id_hash::crc64;
+#endif
+
 struct class_id_t {
 
     constexpr class_id_t(const char* className) noexcept : value() {
-        constexpr CRC engine;
+        constexpr class_id_hash engine;
         value = engine(className);
     }
 
     template<typename ...Args>
     constexpr class_id_t(const char* className, Args&&... d) noexcept : value() {
-        constexpr CRC engine;
+        constexpr class_id_hash engine;
         value = engine(className, std::forward<Args>(d)...);
     }
 
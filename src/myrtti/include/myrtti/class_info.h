@@ -16,53 +16,299 @@
 #define MYRTTI_CLASS_INFO_H
 
 #include "myrtti/class_id.h"
-#include "myrtti/hierarchy.h"
+#include "utils/span.h"
 
-#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// On ELF platforms classes are registered through linker section, see
+// details::section_entry. Define MYRTTI_NO_CLASS_SECTION to fall back
+// to registration by static initializer of each class.
+#if !defined(MYRTTI_NO_CLASS_SECTION) && defined(__ELF__) \
+    && (defined(__GNUC__) || defined(__clang__))
+#define MYRTTI_CLASS_SECTION
+#endif
 
 namespace myrtti {
 
+struct CastTable;
+struct ClassInfo;
+struct Hierarchy;
+struct Object;
+struct ObjectArena;
+
+namespace details {
+    /// @brief Adds class to Hierarchy::instance(). Defined out of line,
+    /// so classes are registered without including hierarchy.h.
+    void register_class(const ClassInfo* cls);
+}
+
+/// @brief Class description.
+///
+/// ClassInfo is constexpr-constructible, so instances created by
+/// DEFINE_RTTI are constant-initialized static data: `info()` is a plain
+/// address load, with no guard checks and no heap allocations.
+/// Instances are linked into Hierarchy separately, see Hierarchy::add.
+/// On ELF platforms class sections of loaded modules are linked by the
+/// first hierarchy query, or by the first reader which finds class
+/// unregistered. Elsewhere each class is linked during static
+/// initialization (see MYRTTI_REGISTER_CLASS), or by the first reader,
+/// whichever comes first.
 struct ClassInfo {
+    using info_getter_t = const ClassInfo* (*)();
+
+    /// @brief Thunks used to create objects of class, see createInstance.
+    struct factory_t {
+        std::size_t alignment;
+
+        /// @brief Default-constructs object in given storage.
+        Object* (*construct)(void* storage);
+
+        /// @brief Destroys object constructed in given storage.
+        void (*destroy)(void* storage);
+    };
+
     const char* name;
 
-    template<class ThisClass, class ...Parents>
-    static inline std::unique_ptr<ClassInfo> create(const char* name) {
-        // Force all parent ClassInfos to be created.
-        (
-            [&] {
-                Parents::info();
-            } (), ...
-        );
-        return std::make_unique<ClassInfo>(name, ThisClass::class_id(), mk_class_ids<Parents...>());
-    }
+    /// @brief Size of class objects, 0 if unknown.
+    std::size_t size = 0;
+
+    /// @brief Profile-guided cast table, set by Hierarchy::setCastLayout.
+    /// Casts read it without lock, see details::CastTableGuard.
+    mutable std::atomic<const CastTable*> castTable{nullptr};
+
+    /// @brief Factory of class, nullptr if class is not default
+    /// constructible.
+    const factory_t* factory = nullptr;
 
-    ClassInfo(const char* name, class_id_t classId) : name(name), id(classId) {
-        Hierarchy::instance()->add(this, std::array<class_id_t, 0>());
+    /// @brief Creates root class description.
+    constexpr ClassInfo(
+        const char* name,
+        class_id_t classId,
+        std::size_t size = 0,
+        const factory_t* factory = nullptr
+    )
+    : name(name), size(size), factory(factory), id(classId) {}
+
+    /// @brief Creates class description.
+    /// @param name class name
+    /// @param classId class id
+    /// @param parentIds ids of direct parents, in inheritance order
+    /// @param parentInfos getters of direct parents descriptions, used to
+    ///        link parents before their children.
+    /// @param numParents amount of direct parents
+    /// @param size size of class objects
+    /// @param factory factory of class, if it is default constructible
+    constexpr ClassInfo(
+        const char* name,
+        class_id_t classId,
+        const class_id_t* parentIds,
+        const info_getter_t* parentInfos,
+        std::size_t numParents,
+        std::size_t size = 0,
+        const factory_t* factory = nullptr
+    )
+    : name(name), size(size), factory(factory), id(classId),
+      parentIds(parentIds), parentInfos(parentInfos), numParents(numParents) {}
+
+    /// @brief Creates description of class, which parents descriptions
+    /// are available already, e.g. for classes defined at run time.
+    /// @param name class name
+    /// @param classId class id
+    /// @param parentIds ids of direct parents, in inheritance order
+    /// @param parentClasses direct parents descriptions
+    /// @param numParents amount of direct parents
+    /// @param size size of class objects
+    /// @param factory factory of class, if it is default constructible
+    constexpr ClassInfo(
+        const char* name,
+        class_id_t classId,
+        const class_id_t* parentIds,
+        const ClassInfo* const* parentClasses,
+        std::size_t numParents,
+        std::size_t size = 0,
+        const factory_t* factory = nullptr
+    )
+    : name(name), size(size), factory(factory), id(classId),
+      parentIds(parentIds), parentClasses(parentClasses), numParents(numParents) {}
+
+    class_id_t getId() const { return id; }
+
+    /// @return ids of direct parents, in inheritance order.
+    span<const class_id_t> getParents() const { return {parentIds, numParents}; }
+
+    /// @return description of i-th direct parent, in inheritance order.
+    const ClassInfo* getParentInfo(std::size_t i) const {
+        return parentClasses ? parentClasses[i] : parentInfos[i]();
     }
 
-    template<typename ArrayT>
-    ClassInfo(const char* name, class_id_t classId, const ArrayT& parents)
-    : name(name), id(classId) {
-        // std::cout << "Registered class: " << name << "\n";
-        // for (const ClassInfo* p : parents) {
-        //     std::cout << "    parent: " << p->name << "\n";
-        // }
-        Hierarchy::instance()->add(this, parents);
+    /// @return dense index of class in Hierarchy, classes get them in
+    /// registration order. Valid for registered classes only.
+    uint32_t getIndex() const { return index; }
+
+    /// @return true if class has been linked into Hierarchy.
+    bool isRegistered() const { return registered.load(std::memory_order_acquire); }
+
+    /// @brief Links class into Hierarchy, unless it is linked already.
+    /// Classes might be used before static initializer registering them
+    /// runs (e.g. by static initializer of another translation unit), so
+    /// readers of registration results call it first.
+    void ensureRegistered() const {
+        if (/* [[unlikely]] */ !isRegistered())
+            details::register_class(this);
     }
 
-    class_id_t getId() const { return id; }
+    /// @brief Default-constructs object of class, e.g. resolved by id or
+    /// name from serialized data. Object should be destroyed by
+    /// ObjectArena::destroy.
+    /// @param arena arena which provides object storage
+    /// @return object, or nullptr if class has no factory.
+    Object* createInstance(ObjectArena& arena) const;
+
 private:
+    friend struct Hierarchy;
+    friend span<const ClassInfo* const> windup_order(const ClassInfo* cls);
+    friend span<const ClassInfo* const> unwind_order(const ClassInfo* cls);
+
+    class_id_t id;
 
+    const class_id_t* parentIds = nullptr;
+    const info_getter_t* parentInfos = nullptr;
+    const ClassInfo* const* parentClasses = nullptr;
+    std::size_t numParents = 0;
+
+    mutable uint32_t index = 0;
+
+    /// @brief Class linearizations, both contain class itself and all its
+    /// ancestors, so they have the same size. Set by Hierarchy::add.
+    mutable const ClassInfo* const* windupOrder = nullptr;
+    mutable const ClassInfo* const* unwindOrder = nullptr;
+    mutable std::size_t orderSize = 0;
+
+    mutable std::atomic<bool> registered{false};
+};
+
+/// @brief Class with all its ancestors in order constructors are called:
+/// parents first, in inheritance order, then class itself.
+/// Same order as Hierarchy::windup walks.
+/// @param cls class, it is registered if it is not yet
+inline span<const ClassInfo* const> windup_order(const ClassInfo* cls) {
+    cls->ensureRegistered();
+    return {cls->windupOrder, cls->orderSize};
+}
+
+/// @brief Class with all its ancestors in order destructors are called:
+/// class itself first, then its parents, from last to first.
+/// Same order as Hierarchy::unwind walks.
+/// @param cls class, it is registered if it is not yet
+inline span<const ClassInfo* const> unwind_order(const ClassInfo* cls) {
+    cls->ensureRegistered();
+    return {cls->unwindOrder, cls->orderSize};
+}
+
+namespace details {
+    /// @brief Static arrays of parents ids and descriptions getters.
     template<class ...Parents>
-    static std::array<class_id_t, sizeof...(Parents)>
-    mk_class_ids() {
-        return {Parents::class_id()...};
+    struct parents_t {
+        static constexpr std::size_t size = sizeof...(Parents);
+        static constexpr class_id_t ids[] = {Parents::class_id()...};
+        static constexpr ClassInfo::info_getter_t infos[] = {&Parents::info...};
+    };
+
+    /// @brief Factory thunks of class, see ClassInfo::createInstance.
+    /// Defined in runtime.h, for they need Object to be complete.
+    template<class ClassT>
+    struct factory_thunks;
+
+    /// @return factory of class, or nullptr if class is not default
+    ///         constructible (e.g. it is abstract).
+    template<class ClassT>
+    constexpr const ClassInfo::factory_t* factory_of() {
+        if constexpr (std::is_default_constructible_v<ClassT>)
+            return &factory_thunks<ClassT>::value;
+        else
+            return nullptr;
     }
 
-    class_id_t id;
-};
+    /// @brief Links class into hierarchy during static initialization.
+    /// Referencing `registrar<ClassT>::registered` is enough to get
+    /// class registered, it doesn't produce any code at reference site.
+    template<class ClassT>
+    struct registrar {
+        static inline const bool registered = (
+            register_class(ClassT::info()), true
+        );
+    };
+}
 }
 
+#ifdef MYRTTI_CLASS_SECTION
+// Bounds of class section, provided by linker. Each executable and
+// shared library has its own section, so symbols are hidden.
+extern "C" {
+    extern const myrtti::ClassInfo::info_getter_t __start_myrtti_classes[]
+        __attribute__((weak, visibility("hidden")));
+    extern const myrtti::ClassInfo::info_getter_t __stop_myrtti_classes[]
+        __attribute__((weak, visibility("hidden")));
+}
+
+namespace myrtti::details {
+    template<class ClassT>
+    __attribute__((visibility("hidden")))
+    const ClassInfo* info_thunk() { return ClassT::info(); }
+
+    /// @brief Places getter of class description into class section.
+    ///
+    /// Entry is emitted by assembler directives: GCC ignores section
+    /// attribute of templated variables, and refuses to put variables of
+    /// inline functions (COMDAT) and of local classes into one section.
+    /// Entry is emitted by each translation unit which defines class,
+    /// duplicates are skipped by registration.
+    ///
+    /// Module has no code to register its section: the first entry of
+    /// translation unit also emits ELF note with section bounds, notes
+    /// share COMDAT group, so linker keeps one per module. Hierarchy
+    /// finds notes in program headers of loaded modules (see
+    /// dl_iterate_phdr), and registers their sections lazily.
+    template<class ClassT>
+    __attribute__((used, visibility("hidden")))
+    void section_entry() {
+        __asm__(
+            ".pushsection myrtti_classes,\"aw\"\n\t"
+            ".balign %c1\n\t"
+            ".dc.a %c0\n\t"
+            ".popsection\n\t"
+            ".ifndef .Lmyrtti_classes_note\n\t"
+            ".hidden __start_myrtti_classes\n\t"
+            ".hidden __stop_myrtti_classes\n\t"
+            ".pushsection .note.myrtti,\"aG\",%%note,myrtti_classes_note,comdat\n\t"
+            ".balign 4\n"
+            ".Lmyrtti_classes_note:\n\t"
+            ".long 2f - 1f\n\t"
+            ".long 4f - 3f\n\t"
+            ".long 1\n"
+            "1:\t.asciz \"myrtti\"\n"
+            "2:\t.balign 4\n"
+            "3:\t.long __start_myrtti_classes - 3b\n\t"
+            ".long __stop_myrtti_classes - 3b\n"
+            "4:\n\t"
+            ".popsection\n\t"
+            ".endif"
+            :: "i"(&info_thunk<ClassT>), "i"(alignof(ClassInfo::info_getter_t))
+        );
+    }
+}
+
+/// @brief Gets class registered along with the rest of module classes.
+#define MYRTTI_REGISTER_CLASS(cn)                                     \
+    (void)&::myrtti::details::section_entry<cn>
+#else
+#define MYRTTI_REGISTER_CLASS(cn)                                     \
+    (void)&::myrtti::details::registrar<cn>::registered
+#endif
+
 std::ostream& operator <<(std::ostream& s, const myrtti::ClassInfo* clid);
 std::ostream& operator <<(std::ostream& s, const myrtti::ClassInfo& clid);
 
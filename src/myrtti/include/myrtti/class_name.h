@@ -0,0 +1,50 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRTTI_CLASS_NAME_H
+#define MYRTTI_CLASS_NAME_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace myrtti {
+
+/// @brief 64-bit FNV-1a hash of class name, used by name index of
+/// Hierarchy.
+constexpr uint64_t hash_class_name(std::string_view name) noexcept {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (char c : name)
+        h = (h ^ uint8_t(c)) * 0x100000001b3ull;
+    return h;
+}
+
+/// @brief Class name with its hash, key for lookups by name (see
+/// Hierarchy::getClassInfo). Constructor is constexpr, so names known at
+/// compile time are hashed during compilation:
+///
+///     constexpr myrtti::class_name_t circle{"Circle"};
+///     auto* cls = myrtti::Hierarchy::instance()->getClassInfo(circle);
+///
+/// Name is not copied, it should outlive the key.
+struct class_name_t {
+    constexpr explicit class_name_t(std::string_view name) noexcept
+    : name(name), hash(hash_class_name(name)) {}
+
+    std::string_view name;
+    uint64_t hash;
+};
+
+} // namespace myrtti
+
+#endif
@@ -0,0 +1,102 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef MYRTTI_CLASS_SET_INDEX_H
+#define MYRTTI_CLASS_SET_INDEX_H
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+
+#include "myrtti/class_info.h"
+
+namespace myrtti {
+
+/// @brief Answers the question visitors, error handlers and routing
+/// tables ask: given fixed set of classes, which of its members is the
+/// nearest ancestor of class?
+///
+/// Nearest member is the first one in unwind order of class (see
+/// unwind_order), so it is class itself if it belongs to set, and it is
+/// the same member Visitor would pick.
+///
+/// Answers are memoized lazily into dense array indexed by class index
+/// (see ClassInfo::getIndex), so once class has been asked for, next
+/// lookups are a single load. Memoized answers never go stale:
+/// ancestors of class don't change while it is registered, and indices
+/// are not reused. New classes get new indices, past the end of array,
+/// so array just grows. Growth replaces array by a copy (RCU), arrays
+/// are retired along with index, so lookups never take a lock and index
+/// may be shared between threads.
+struct ClassSetIndex {
+    /// @brief Result of lookup for class which has no ancestors in set.
+    static constexpr uint32_t npos = ~uint32_t(0);
+
+    /// @param members set members, only first occurrence of duplicated
+    ///        member counts. Members don't have to be registered yet.
+    explicit ClassSetIndex(span<const class_id_t> members);
+
+    ClassSetIndex(std::initializer_list<class_id_t> members)
+    : ClassSetIndex(span<const class_id_t>(members.begin(), members.size())) {}
+
+    ~ClassSetIndex();
+
+    ClassSetIndex(const ClassSetIndex&) = delete;
+    ClassSetIndex& operator=(const ClassSetIndex&) = delete;
+
+    /// @brief Finds nearest ancestor of class among set members.
+    /// @param cls class, it is registered if it is not yet
+    /// @return position of member in set (as it has been passed to
+    ///         constructor), or npos if none of cls ancestors is member.
+    uint32_t find(const ClassInfo* cls) const {
+        // Index of unregistered class is not valid yet, slow path
+        // registers it.
+        if (/* [[unlikely]] */ !cls->isRegistered())
+            return findSlow(cls);
+
+        auto* m = memo.load(std::memory_order_acquire);
+        uint32_t i = cls->getIndex();
+        if (i < m->size) {
+            uint32_t pos = m->entries[i].load(std::memory_order_relaxed);
+            if (pos != unknown)
+                return pos;
+        }
+        return findSlow(cls);
+    }
+
+    /// @return position of class in set, or npos if it is not a member.
+    uint32_t position(class_id_t id) const;
+
+private:
+    /// @brief Memo entry of class which hasn't been asked for yet.
+    static constexpr uint32_t unknown = npos - 1;
+
+    struct Memo {
+        uint32_t size;
+        std::unique_ptr<std::atomic<uint32_t>[]> entries;
+    };
+
+    struct Impl;
+
+    uint32_t findSlow(const ClassInfo* cls) const;
+
+    std::unique_ptr<Impl> impl;
+    mutable std::atomic<const Memo*> memo;
+};
+
+} // namespace myrtti
+
+#endif
@@ -17,33 +17,80 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <unordered_map>
-#include <unordered_set>
 #include <stdexcept>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "myrtti/reachability_index.h"
+#include "utils/memory_usage.h"
+#include "utils/small_vector.h"
+
 namespace myrtti {
 
+namespace details {
+    /// @brief Visited marks of DAG walks run by current thread, by dense
+    /// node index. Node is visited by current walk if its mark equals to
+    /// walk epoch, so each walk starts with single increment, rather than
+    /// with clearing marks.
+    struct VisitMarks {
+        std::vector<uint32_t> marks;
+        uint32_t epoch = 0;
+
+        /// @brief True while some walk uses marks, walks started by its
+        /// callbacks have to use marks of their own.
+        bool busy = false;
+    };
+
+    inline thread_local VisitMarks thread_visit_marks;
+}
+
 template <typename NodeIdT>
 struct DAG {
+    DAG() = default;
+
+    DAG(DAG&&) = default;
+    DAG& operator=(DAG&&) = default;
+
+    // Nodes refer their parents by pointers.
+    DAG(const DAG&) = delete;
+    DAG& operator=(const DAG&) = delete;
+
     /// @brief Adds class to hierarchy
     /// @param cls class to be added
     /// @param parents parents list
     template <class ArrayT>
     bool add(NodeIdT cls, const ArrayT& parents) {
 
-        auto [it, inserted] =  nodes.insert(cls);
-        if (!inserted)
+        entry_t& entry = getEntry(cls);
+        if (entry.second.added)
             return false;
 
-        if (parents.empty()) {
-            roots.insert(cls);
-        } else {
-            incomingEdges.emplace(cls, nodes_list_t(begin(parents), end(parents)));
-        }
+        reachability.reset();
+
+        node_t& node = entry.second;
+        node.added = true;
+        node.parents.reserve(parents.size());
+        for (const auto& p : parents)
+            node.parents.push_back(&getEntry(p));
+        return true;
+    }
+
+    /// @brief Removes node, nodes derived from it should be removed first.
+    /// @param cls node to be removed
+    /// @return false if there is no such node
+    bool remove(NodeIdT cls) {
+        auto found = nodes.find(cls);
+        if (found == end(nodes) || !found->second.added)
+            return false;
+        reachability.reset();
+        freeIndices.push_back(found->second.index);
+        nodes.erase(found);
         return true;
     }
 
@@ -51,6 +98,13 @@ struct DAG {
     using node_callback_t = std::function<bool(NodeIdT)>;
 
     /// @brief Deep first search from node to its predecessors.
+    ///
+    /// Callbacks are any callables (or nullptr), so they are inlined
+    /// into walk. Walk keeps explicit stack, so it doesn't overflow call
+    /// stack on deep graphs, and walks which visit up to `inline_nodes`
+    /// nodes don't allocate. Visited nodes are tracked with marks by
+    /// dense node index, see details::VisitMarks.
+    ///
     /// @param startNode node the search starts from
     /// @param onBeforeNode is called for each node before recursive deepings.
     /// @param onAfterNode is called for each node after all subsequent
@@ -61,27 +115,23 @@ struct DAG {
     ///        to first.
     /// @return true if search completed successfully and 'false' if it
     ///         was interrupted by callback.
+    template<typename OnBeforeT, typename OnAfterT = std::nullptr_t>
     bool dfs(
         NodeIdT startNode,
-        const node_callback_t& onBeforeNode,
-        const node_callback_t& onAfterNode = nullptr,
+        OnBeforeT&& onBeforeNode,
+        OnAfterT&& onAfterNode = nullptr,
         bool reversiveSideWalk = false
     ) const {
-        nodes_set_t visited;
+        auto found = nodes.find(startNode);
+        if (found == end(nodes)) {
+            // Unknown node has no predecessors.
+            return invoke(onBeforeNode, startNode) && invoke(onAfterNode, startNode);
+        }
 
         if (/* [[likely]] */ !reversiveSideWalk)
-            return dfsRecursive(
-                visited, startNode,
-                &nodes_list_t::cbegin, &nodes_list_t::cend,
-                onBeforeNode, onAfterNode
-            );
-        else {
-            return dfsRecursive(
-                visited, startNode,
-                &nodes_list_t::crbegin, &nodes_list_t::crend,
-                onBeforeNode, onAfterNode
-            );
-        }
+            return dfsImpl<false>(&*found, onBeforeNode, onAfterNode);
+        else
+            return dfsImpl<true>(&*found, onBeforeNode, onAfterNode);
     }
 
     /// @brief Breadth first search from node to its predecessors.
@@ -89,79 +139,222 @@ struct DAG {
     /// @param onNode is called for each visited node.
     /// @return true if search completed successfully and 'false' if it
     ///         was interrupted by callback.
-    bool bfs(NodeIdT startNode, const node_callback_t& onNode) {
-        nodes_set_t visited;
-        nodes_list_t wl{startNode};
+    template<typename OnNodeT>
+    bool bfs(NodeIdT startNode, OnNodeT&& onNode) const {
+        auto found = nodes.find(startNode);
+        if (found == end(nodes))
+            return invoke(onNode, startNode);
 
-        while (wl.empty()) {
-            nodes_list_t wl2;
-            for (auto nd : wl) {
-                auto [_, inserted] = visited.insert(nd);
-                if (!inserted) continue;
+        visited_t visited(nextIndex);
+        SmallVector<const entry_t*, inline_nodes> wl;
 
-                if (!onNode(nd))
-                    return false;
-
-                if (roots.count(nd))
-                    continue;
-
-                const auto& incoming = incomingEdges[nd];
+        visited.insert(found->second.index);
+        wl.push_back(&*found);
 
-                wl2.insert(end(wl2), begin(incoming), end(incoming));
+        // Worklist is never shrunk, so it is walked in order nodes have
+        // been reached, i.e. level by level.
+        for (std::size_t i = 0; i != wl.size(); ++i) {
+            const entry_t* nd = wl[i];
+            if (!invoke(onNode, nd->first))
+                return false;
+            for (const entry_t* p : nd->second.parents) {
+                if (visited.insert(p->second.index))
+                    wl.push_back(p);
             }
-            wl.swap(wl2);
         }
 
         return true;
     }
 
+    /// @brief Builds reachability index, so `reaches` doesn't walk the
+    /// graph. Index is dropped by any further add or remove.
+    /// @param threads amount of threads index is built with
+    void buildReachability(unsigned threads = 1) {
+        std::vector<uint32_t> parentsBegin(nextIndex + 1, 0);
+        for (const auto& [_, node] : nodes)
+            parentsBegin[node.index + 1] = node.parents.size();
+        for (uint32_t i = 0; i != nextIndex; ++i)
+            parentsBegin[i + 1] += parentsBegin[i];
+
+        std::vector<uint32_t> parents(parentsBegin.back());
+        for (const auto& [_, node] : nodes) {
+            uint32_t k = parentsBegin[node.index];
+            for (const entry_t* p : node.parents)
+                parents[k++] = p->second.index;
+        }
+
+        reachability = std::make_unique<ReachabilityIndex>(
+            span<const uint32_t>(parentsBegin.data(), parentsBegin.size()),
+            span<const uint32_t>(parents.data(), parents.size()),
+            threads
+        );
+    }
+
+    /// @return true if `to` is `from` or one of its predecessors.
+    /// Uses reachability index if it has been built, walks graph otherwise.
+    bool reaches(NodeIdT from, NodeIdT to) const {
+        auto foundFrom = nodes.find(from);
+        auto foundTo = nodes.find(to);
+        if (foundFrom == end(nodes) || foundTo == end(nodes))
+            return from == to;
+
+        if (reachability)
+            return reachability->reaches(foundFrom->second.index, foundTo->second.index);
+
+        return !dfs(from, [&](NodeIdT nd) { return nd != to; });
+    }
+
+    /// @return heap memory taken by nodes, edges and reachability index.
+    std::size_t memoryUsage() const {
+        std::size_t res = node_container_bytes(nodes) + vector_bytes(freeIndices);
+        for (const auto& [_, node] : nodes)
+            res += vector_bytes(node.parents);
+        if (reachability)
+            res += sizeof(ReachabilityIndex) + reachability->memoryUsage();
+        return res;
+    }
+
 private:
 
-    using nodes_list_t = std::vector<NodeIdT>;
-    using nodes_set_t = std::unordered_set<NodeIdT>;
-
-    template <typename ItPtrs>
-    bool dfsRecursive(
-        nodes_set_t &visited,
-        NodeIdT curNode,
-        ItPtrs beginPtr,
-        ItPtrs endPtr,
-        const node_callback_t& onBeforeNode,
-        const node_callback_t& onAfterNode = nullptr
-    ) const {
-        auto [_, inserted] = visited.insert(curNode);
-        if (!inserted)
-            return true;
+    struct node_t;
+    using entry_t = std::pair<const NodeIdT, node_t>;
 
-        if (onBeforeNode && !onBeforeNode(curNode))
-            return false;
+    struct node_t {
+        /// @brief Dense index, visited marks are indexed by it.
+        uint32_t index;
 
-        auto incomingIt = incomingEdges.find(curNode);
-        if (incomingIt != end(incomingEdges)) {
+        /// @brief False if node is only referred as parent, but has not
+        /// been added itself.
+        bool added = false;
 
-            const auto& incoming = incomingIt->second;
+        /// @brief Direct parents, nodes never move, so they are referred
+        /// by pointers and walk doesn't look them up.
+        std::vector<const entry_t*> parents;
+    };
 
-            auto beginF = std::bind(beginPtr, &incoming);
-            auto endF = std::bind(endPtr, &incoming);
+    entry_t& getEntry(NodeIdT id) {
+        auto found = nodes.find(id);
+        if (found != end(nodes))
+            return *found;
 
-            for (auto i = beginF(), e = endF(); i!=e; ++i) {
-                NodeIdT p = *i;
-                if (!dfsRecursive(visited, p, beginPtr, endPtr, onBeforeNode, onAfterNode))
-                    return false;
+        uint32_t index;
+        if (!freeIndices.empty()) {
+            index = freeIndices.back();
+            freeIndices.pop_back();
+        } else {
+            index = nextIndex++;
+        }
+        return *nodes.emplace(id, node_t{index}).first;
+    }
+
+    /// @brief Walks which visit up to this amount of nodes don't allocate.
+    static constexpr std::size_t inline_nodes = 32;
+
+    /// @brief Invokes walk callback, absent one lets walk continue.
+    template<typename FnT>
+    static bool invoke(FnT& fn, NodeIdT node) {
+        using fn_t = std::decay_t<FnT>;
+        if constexpr (std::is_same_v<fn_t, std::nullptr_t>)
+            return true;
+        else if constexpr (std::is_pointer_v<fn_t> || std::is_same_v<fn_t, node_callback_t>)
+            return !fn || fn(node);
+        else
+            return fn(node);
+    }
+
+    /// @brief Visited nodes of single walk.
+    struct visited_t {
+        explicit visited_t(std::size_t size) {
+            if (!details::thread_visit_marks.busy) {
+                shared = &details::thread_visit_marks;
+                shared->busy = true;
+            } else {
+                shared = &own;
+            }
+
+            if (shared->marks.size() < size)
+                shared->marks.resize(size, 0);
+            if (/* [[unlikely]] */ !++shared->epoch) {
+                std::fill(begin(shared->marks), end(shared->marks), 0);
+                shared->epoch = 1;
             }
+
+            marks = shared->marks.data();
+            epoch = shared->epoch;
         }
 
-        if (onAfterNode && !onAfterNode(curNode))
+        ~visited_t() {
+            if (shared != &own)
+                shared->busy = false;
+        }
+
+        visited_t(const visited_t&) = delete;
+        visited_t& operator=(const visited_t&) = delete;
+
+        bool insert(uint32_t index) {
+            if (marks[index] == epoch)
+                return false;
+            marks[index] = epoch;
+            return true;
+        }
+
+    private:
+        details::VisitMarks* shared;
+        details::VisitMarks own;
+        uint32_t* marks;
+        uint32_t epoch;
+    };
+
+    /// @brief Node being walked: its direct parents and next one to visit.
+    struct frame_t {
+        const entry_t* node;
+        std::size_t next;
+    };
+
+    template <bool Reverse, typename OnBeforeT, typename OnAfterT>
+    bool dfsImpl(const entry_t* startNode, OnBeforeT& onBeforeNode, OnAfterT& onAfterNode) const {
+        visited_t visited(nextIndex);
+        SmallVector<frame_t, inline_nodes> stack;
+
+        visited.insert(startNode->second.index);
+        if (!invoke(onBeforeNode, startNode->first))
             return false;
+        stack.push_back({startNode, 0});
+
+        while (!stack.empty()) {
+            frame_t& top = stack.back();
+            const auto& parents = top.node->second.parents;
+
+            if (top.next == parents.size()) {
+                NodeIdT node = top.node->first;
+                stack.pop_back();
+                if (!invoke(onAfterNode, node))
+                    return false;
+                continue;
+            }
+
+            std::size_t i = top.next++;
+            const entry_t* p = parents[Reverse ? parents.size() - 1 - i : i];
+            if (!visited.insert(p->second.index))
+                continue;
+            if (!invoke(onBeforeNode, p->first))
+                return false;
+            stack.push_back({p, 0});
+        }
 
         return true;
-    };
+    }
+
+    /// @brief All nodes, including ones which are only referred as
+    /// parents. Nodes of unordered_map never move.
+    std::unordered_map<NodeIdT, node_t> nodes;
 
-    nodes_set_t nodes;
-    nodes_set_t roots;
+    /// @brief Indices of removed nodes, they are reused by new ones.
+    std::vector<uint32_t> freeIndices;
+    uint32_t nextIndex = 0;
 
-    /// @brief collection of incoming edges for node privided as a key.
-    std::unordered_map<NodeIdT, nodes_list_t> incomingEdges;
+    /// @brief Optional, see buildReachability.
+    std::unique_ptr<ReachabilityIndex> reachability;
 };
 
 } // namespace myrtti
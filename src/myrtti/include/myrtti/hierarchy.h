@@ -15,56 +15,203 @@
 #ifndef MYRTTI_HIERARCHY_H
 #define MYRTTI_HIERARCHY_H
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
-#include <sstream>
-#include <stdexcept>
-#include <unordered_map>
+#include <string>
 #include <vector>
 
 #include "myrtti/class_id.h"
-#include "myrtti/dag.h"
+#include "myrtti/class_name.h"
+#include "utils/span.h"
 
 namespace myrtti {
 
 struct ClassInfo;
-template <typename NodeT> struct DAG;
+struct CastLayout;
+struct HierarchyImage;
 
+/// @brief Registry of all classes.
+///
+/// Thread safety: registration (add, setCastLayout) is serialized
+/// behind a writer lock. Readers never take it: read queries work on
+/// an immutable snapshot, published via atomic pointer swap (RCU).
+/// Each registration publishes new snapshot before it returns, so read
+/// queries are wait-free: they only load current snapshot, and never
+/// wait for writers or for each other.
+///
+/// Snapshot tables are shared by all snapshots: classes registered since
+/// previous snapshot (e.g. by just loaded module) are appended to them,
+/// rather than whole snapshot is recomputed. So cost of module loading,
+/// or of class definition at run time (see defineClass), depends on
+/// amount of new classes and their ancestors only. Replaced snapshots
+/// are reclaimed by epoch based scheme (see below), once readers which
+/// might use them are finished.
+///
+/// Snapshot is a set of flat CSR-style arrays indexed by dense class
+/// index (see ClassInfo::getIndex). Once class set is fixed, hierarchy
+/// may be frozen (see freeze), then node based containers used for
+/// registration are released, and only flat arrays remain.
+///
+/// Classes may be removed (see remove), e.g. before unloading shared
+/// library which defines them. Memory retired by removal is reclaimed
+/// with epoch based scheme: each read query announces global epoch it
+/// has started in, and remove waits until all queries started before
+/// removal are finished. So readers still never take a lock.
+///
+/// This header is not included by myrtti.h: classes are registered
+/// through details::register_class, so only code
+/// which queries hierarchy depends on it. Writer side state lives in
+/// Impl, which is defined in hierarchy.cpp, only reader side atomics
+/// stay here.
+///
+/// On ELF platforms DEFINE_RTTI puts class into linker section, and each
+/// module (executable or shared library) notes its section in program
+/// headers (see details::section_entry). No code runs during static
+/// initialization: sections of loaded modules are found with
+/// dl_iterate_phdr and registered by the first query, or by the first
+/// registration of class. Modules loaded later are registered when
+/// their classes are first used, or at the end of ModuleScope.
 struct Hierarchy {
 
-    /// @brief Adds class to hierarchy
-    /// @param cls class to be added
-    /// @param parents parents list
-    template<typename ArrayT>
-    void add(const ClassInfo *cls, const ArrayT& parentIds) {
-
-        auto clsId = resolveClassInfoId(cls);
-
-        bool inserted = dag.add(clsId, parentIds);
-        assert(inserted && "We can register each class only once.");
-
-        auto [it, added] = idToClass.emplace(clsId, cls);
-        if (!added) {
-            std::ostringstream strm;
-            strm << "Class " << cls
-                 << " has colliding id. Unable to maintain hierarchy"
-                 << " consider changing class name or CRC64 initial state.";
-            throw std::runtime_error(strm.str());
-        }
+    /// @brief Classes registered together, e.g. class section of shared
+    /// library. See ModuleScope.
+    struct Module {
+        std::vector<const ClassInfo*> classes;
+    };
+
+    /// @brief Attributes classes registered by current thread to module,
+    /// while scope is alive. Typical usage is wrapping dlopen:
+    ///
+    ///     Hierarchy::Module plugin;
+    ///     {
+    ///         Hierarchy::ModuleScope scope(plugin);
+    ///         handle = dlopen(path, RTLD_NOW);
+    ///     }
+    ///     ...
+    ///     Hierarchy::instance()->remove(plugin);
+    ///     dlclose(handle);
+    ///
+    /// Parents registered as a part of class registration go to the same
+    /// module. Scopes may be nested, innermost one takes classes.
+    struct ModuleScope {
+        explicit ModuleScope(Module& module);
+        ~ModuleScope();
+
+        ModuleScope(const ModuleScope&) = delete;
+        ModuleScope& operator=(const ModuleScope&) = delete;
+
+    private:
+        Module* prev;
+    };
+
+    /// @brief Memory taken by registry, in bytes. See memoryStats.
+    struct memory_stats_t {
+
+        /// @brief Cross pointers of class objects (see Object::crossPtrs).
+        struct cross_ptrs_t {
+            const ClassInfo* cls;
+
+            /// @brief Amount of cross pointers, one per class in lineage.
+            std::size_t entries;
+
+            /// @brief Heap memory taken by cross pointers of each object.
+            std::size_t bytes;
+        };
+
+        /// @brief ClassInfo objects, and names and parents of classes
+        /// defined at run time (see defineClass).
+        std::size_t classInfos = 0;
+
+        /// @brief Classes by dense index and their linearizations (see
+        /// windup_order).
+        std::size_t linearizations = 0;
+
+        /// @brief Node based id to class map, released by freeze.
+        std::size_t idToClass = 0;
+
+        /// @brief Node sets and edge vectors of DAG, released by freeze.
+        std::size_t dag = 0;
 
-        // Get ancestors cache for O(0) 'isParent' implementation.
-        // tradeof: RAM consumption N^2 (N amount of classes)
-        if (!parentIds.empty()) {
-            auto [it, _] = ancestorsCache.emplace(clsId, classes_set_t());
-            auto &ancestors = it->second;
-
-            for (auto p : parentIds) {
-                auto &pAncestors = ancestorsCache[p];
-                ancestors.insert(begin(pAncestors), end(pAncestors));
-            }
-            ancestors.insert(begin(parentIds), end(parentIds));
+        /// @brief Lookup tables of snapshots: id and name slots, parents
+        /// and compressed ancestors sets, including buffers retained for
+        /// older snapshots.
+        std::size_t tables = 0;
+
+        /// @brief Binary image, see loadImage.
+        std::size_t image = 0;
+
+        /// @brief Current snapshot and replaced ones which are not
+        /// reclaimed yet, along with their children.
+        std::size_t snapshots = 0;
+
+        /// @brief Descendants lists (see descendants), including ones
+        /// retained for older snapshots.
+        std::size_t descendants = 0;
+
+        /// @brief Per object overhead, by registered class, in
+        /// registration order.
+        std::vector<cross_ptrs_t> crossPtrs;
+
+        /// @return memory taken by registry, objects overhead is not
+        ///         included.
+        std::size_t total() const {
+            return classInfos + linearizations + idToClass + dag
+                + tables + image + snapshots + descendants;
         }
-    }
+    };
+
+    Hierarchy();
+    ~Hierarchy();
+
+    /// @brief Adds class to hierarchy. Parents are added first, adding
+    /// already registered class does nothing.
+    /// @param cls class to be added
+    /// @throw std::runtime_error if class id collides with id of
+    ///        another registered class.
+    void add(const ClassInfo *cls);
+
+    /// @brief Adds classes to hierarchy under single lock, e.g. whole
+    /// class section of module (see details::section_entry).
+    /// @param classes classes to be added, in any order, already
+    ///        registered ones are skipped.
+    /// @throw std::runtime_error if class id collides with id of
+    ///        another registered class.
+    void add(span<const ClassInfo* const> classes);
+
+    /// @brief Defines class at run time, e.g. by scripting layer, and
+    /// adds it to hierarchy. Class may derive from classes defined with
+    /// DEFINE_RTTI, and from other run time classes. Its id is computed
+    /// from name, the same way as for DEFINE_RTTI, it has no factory.
+    /// Description is owned by hierarchy and is released once class is
+    /// removed (see remove). Like add, costs in proportion to amount of
+    /// class ancestors, not to amount of registered classes.
+    /// @param name class name
+    /// @param parents direct parents, in inheritance order
+    /// @return description of defined class
+    /// @throw std::runtime_error if class id collides with id of
+    ///        another registered class.
+    const ClassInfo* defineClass(const std::string& name, span<const ClassInfo* const> parents);
+
+    /// @brief Removes class from hierarchy. Once it returns, no read
+    /// query references class anymore, so its memory may be released.
+    /// Objects of removed class should be destroyed before, ranges
+    /// returned by descendants() are invalidated.
+    /// Removing not registered class does nothing.
+    /// Indices of removed classes are not reused, so indices of
+    /// remaining classes don't change (see ClassInfo::getIndex).
+    /// @param cls class to be removed
+    /// @throw std::runtime_error if there are registered classes derived
+    ///        from removed one.
+    void remove(const ClassInfo *cls);
+
+    /// @brief Removes all classes of module, see remove(cls).
+    /// Module is emptied.
+    /// @throw std::runtime_error if there are registered classes derived
+    ///        from removed ones, which don't belong to module.
+    void remove(Module& module);
 
     /// @brief Checks child-parent relation.
     /// NOTE: this is a duplicated feature of Object::cast<T>
@@ -74,59 +221,123 @@ struct Hierarchy {
     /// @param child child class ID
     /// @param parent parent class ID
     /// @return true if relation is confirmed
-    bool isParent(class_id_t child, class_id_t parent) {
-        return ancestorsCache.count(child)
-            && ancestorsCache[child].count(parent);
-    }
+    bool isParent(class_id_t child, class_id_t parent) const;
 
     /// @brief Callback type for use with hierarchy walking methods.
     using node_callback_t = std::function<bool(const ClassInfo *)>;
 
     /// @brief Invokes custom callback follwing classes as it would call
-    /// constructors.
+    /// constructors. See also windup_order.
     /// @param cls cls the search starts from
     /// @param onNode node callback.
     /// @return true if search completed successfully and 'false' if it
     ///         was interrupted by callback.
-    bool windup(class_id_t clsid, const node_callback_t& onNode) {
-        return dag.dfs(clsid,
-            /*onBeforeNode*/ nullptr,
-            /*onAfterNode*/ [&](class_id_t traversedClsId) {
-                const ClassInfo* traversedCls = idToClass[traversedClsId];
-                return onNode(traversedCls);
-            }
-        );
-    }
+    bool windup(class_id_t clsid, const node_callback_t& onNode) const;
 
     /// @brief Invokes custom callback follwing classes as it would call
-    /// destructors.
+    /// destructors. See also unwind_order.
     /// @param cls cls the search starts from
     /// @param onNode node callback.
     /// @return true if search completed successfully and 'false' if it
     ///         was interrupted by callback.
-    bool unwind(class_id_t clsid, const node_callback_t& onNode) {
-        return dag.dfs(clsid,
-            /*onBeforeNode*/ [&](class_id_t traversedClsId) {
-                const ClassInfo* traversedCls = idToClass[traversedClsId];
-                return onNode(traversedCls);
-            },
-            /*onAfterNode*/ nullptr,
-            /*reversiveSideWalk*/ true
-        );
-    }
+    bool unwind(class_id_t clsid, const node_callback_t& onNode) const;
 
     /// @brief Resolves ClassInfo by given class_id.
     /// @param clsid class_id instance to be resolved for
     /// @return ClassInfo pointer or nullptr is there is no such class
     //          registered.
-    const ClassInfo* getClassInfo(class_id_t clsid) const {
-        auto found = idToClass.find(clsid);
-        if (found != end(idToClass))
-            return found->second;
+    const ClassInfo* getClassInfo(class_id_t clsid) const;
 
-        return nullptr;
-    }
+    /// @brief Resolves ClassInfo by class name (see ClassInfo::name),
+    /// e.g. one read from configuration or network. Costs O(1).
+    /// Names are not unique: classes with the same name might be defined
+    /// in different scopes, see getClassesByName.
+    /// @param name class name
+    /// @return ClassInfo pointer, or nullptr if there is no class with
+    ///         such name, or there are several ones.
+    const ClassInfo* getClassInfo(const class_name_t& name) const;
+
+    /// @brief Resolves all classes with given name.
+    /// @param name class name
+    /// @return classes in registration order.
+    std::vector<const ClassInfo*> getClassesByName(const class_name_t& name) const;
+
+    /// @brief Enumerates all registered classes derived from given one.
+    /// Lists of descendants are maintained by registration, so call
+    /// costs O(log n) at most and doesn't allocate.
+    /// Range remains valid until some class is registered or removed,
+    /// it doesn't include classes registered afterwards.
+    /// @param clsid class id
+    /// @param byDepth false to order descendants in registration order,
+    ///        which is topological one (parents before children),
+    ///        true to order them by distance from given class (direct
+    ///        children first).
+    /// @return descendants of class, empty for unknown class.
+    span<const ClassInfo* const> descendants(class_id_t clsid, bool byDepth = false) const;
+
+    /// @brief Finds most derived common bases of two classes (type join).
+    /// Here class is considered as its own ancestor, so if `b` derives
+    /// `a`, result is `a`.
+    /// @param a first class id
+    /// @param b second class id
+    /// @return common ancestors which are not ancestors of each other,
+    ///         in registration order. Empty if one of classes is unknown.
+    std::vector<const ClassInfo*> commonAncestors(class_id_t a, class_id_t b) const;
+
+    /// @brief Finds most derived common bases of given classes, same as
+    /// commonAncestors(a, b), but for any amount of classes.
+    std::vector<const ClassInfo*> commonAncestors(span<const class_id_t> ids) const;
+
+    /// @brief Publishes registry as flat arrays and releases node based
+    /// containers used for registration.
+    /// Classes still may be added after freeze, but first such addition
+    /// has to restore containers, which is O(N).
+    void freeze();
+
+    /// @brief Writes registry into binary image file, which can be used
+    /// to speed up startup of the same binary (see loadImage).
+    /// @param path image file path
+    /// @throw std::runtime_error if file can not be written.
+    void saveImage(const std::string& path) const;
+
+    /// @brief Maps binary image written by saveImage and uses it instead
+    /// of computing registry tables. Image is validated against
+    /// registered classes: they should have the same ids, names and
+    /// parents, and should be registered in the same order.
+    /// Hierarchy gets frozen (see freeze).
+    ///
+    /// Image might also be given by MYRTTI_HIERARCHY_IMAGE environment
+    /// variable. Then it is attached before static initialization, so
+    /// classes are registered without building node based containers,
+    /// until first class which doesn't match image.
+    ///
+    /// @param path image file path
+    /// @return true if image matches registered classes and has been
+    ///         attached.
+    bool loadImage(const std::string& path);
+
+    /// @brief Freeze hierarchy automatically by first read query, which
+    /// follows registration or this call. Query freezes hierarchy only if
+    /// writer lock is free, otherwise the next one tries, so queries
+    /// still never wait.
+    /// @param enabled true to enable automatic freeze.
+    void setAutoFreeze(bool enabled);
+
+    /// @return true if hierarchy is frozen.
+    bool isFrozen() const;
 
+    /// @brief Reports memory taken by registry, and cross pointers
+    /// overhead of objects of each class. Sizes of container nodes are
+    /// measured with standard library in use (see node_container_bytes).
+    /// Costs O(N) and takes writer lock, so it is meant for diagnostics.
+    memory_stats_t memoryStats() const;
+
+    /// @brief Applies profile-guided cast tables (see CastLayout) to
+    /// registered classes, and to classes which will be registered later.
+    /// @param layout layout to be applied, nullptr detaches tables.
+    void setCastLayout(std::shared_ptr<const CastLayout> layout);
+
+    Hierarchy(const Hierarchy& src) = delete;
     Hierarchy& operator=(const Hierarchy& src) = delete;
 
     static Hierarchy* instance() {
@@ -136,33 +347,41 @@ struct Hierarchy {
 
 private:
 
-    /// @brief Picks classInfo->getId(), where classInfo is a pointer to
-    /// incomplete class.
-    ///
-    /// This is a helper method to prevent circular dependency
-    /// between ClassInfo and Hierarchy. In this header we only can use
-    /// incomplete ClassInfo. And in order to call one of its methods
-    /// we should move it to .cpp part.
-    /// @param classInfo - ClassInfo pointer
-    /// @return class_id for given classInfo.
-    static class_id_t resolveClassInfoId(const ClassInfo* classInfo);
-
-    // TODO: in order to reduce compile time impact we could
-    // move out direct DAG template usage into .cpp file.
-    // We can do it through HierarchyImpl which will be defined
-    // in .cpp. It allows to declare DAG template in .cpp, thus reducing
-    // complexity of task for those who will use header.
-    // With high probability this impl will be inlined by compiler
-    // optimizations.
-    // As an alternative we can use shared_ptr, but it might be slower.
-    // std::shared_ptr<DAG<const ClassInfo*>> dag;
-    DAG<class_id_t> dag;
-
-    using classes_map_t = std::unordered_map<class_id_t, const ClassInfo*>;
-    using classes_set_t = std::unordered_set<class_id_t>;
-
-    classes_map_t idToClass;
-    std::unordered_map<class_id_t, classes_set_t> ancestorsCache;
+    friend struct HierarchyImage;
+
+    /// @brief Writer side: registered classes and node based containers,
+    /// guarded by writer lock.
+    struct Impl;
+
+    /// @brief Immutable copy of registry, read queries work on it.
+    struct Snapshot;
+
+    /// @return up to date snapshot.
+    const Snapshot* view() const;
+
+    /// @brief Slow path of view(): freezes hierarchy, see setAutoFreeze.
+    void freezeOnQuery() const;
+
+    /// @brief Registers class sections of modules loaded since previous
+    /// scan. Called by the first query and by ModuleScope.
+    void scanSections() const;
+
+    /// @brief Implementation of remove.
+    void removeClasses(span<const ClassInfo* const> removed);
+
+    std::unique_ptr<Impl> impl;
+
+    // Reader side, queries check it without taking writer lock.
+
+    /// @brief Set by registration if hierarchy should be frozen by the
+    /// next query, see setAutoFreeze.
+    mutable std::atomic<bool> freezePending{false};
+
+    /// @brief Set once class sections of loaded modules are registered,
+    /// the first query scans them otherwise.
+    mutable std::atomic<bool> sectionsScanned{false};
+
+    std::atomic<const Snapshot*> snapshot{nullptr};
 };
 
 } // namespace myrtti
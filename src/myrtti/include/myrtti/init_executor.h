@@ -0,0 +1,99 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRTTI_INIT_EXECUTOR_H
+#define MYRTTI_INIT_EXECUTOR_H
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "myrtti/class_info.h"
+
+namespace myrtti {
+
+/// @brief Runs per class initialization tasks (e.g. schema building,
+/// tables warmup) on a thread pool, each class after all its ancestors,
+/// i.e. in the order Hierarchy::windup visits them.
+///
+/// Whole graph of given classes and their ancestors, as registered in
+/// Hierarchy, is scheduled at once: task becomes ready as soon as tasks
+/// of its direct parents are done, so independent branches run
+/// concurrently. Ancestors without tasks only pass readiness down.
+///
+/// Executor is not thread safe, tasks are added and run by one thread.
+struct InitExecutor {
+    using task_t = std::function<void(const ClassInfo*)>;
+
+    /// @brief Timings of run.
+    struct report_t {
+        using duration_t = std::chrono::nanoseconds;
+
+        /// @brief Amount of tasks run.
+        std::size_t tasks = 0;
+
+        /// @brief Wall time of run.
+        duration_t wall{0};
+
+        /// @brief Sum of tasks durations. Tasks are measured while they
+        /// run concurrently, so contention of threads (shared cores,
+        /// caches, locks) is included: it is not a serial run baseline.
+        duration_t taskTime{0};
+
+        /// @brief Duration of the longest chain of dependent tasks, no
+        /// amount of threads makes run faster.
+        duration_t criticalPath{0};
+
+        /// @brief Amount of tasks on critical path.
+        std::size_t criticalPathLength = 0;
+
+        /// @return average amount of tasks running at once, i.e. task
+        /// time versus wall time.
+        double speedup() const {
+            return wall.count() ? double(taskTime.count()) / wall.count() : 1.0;
+        }
+
+        /// @return speedup with unlimited amount of threads, task time
+        /// versus critical path.
+        double maxSpeedup() const {
+            return criticalPath.count() ? double(taskTime.count()) / criticalPath.count() : 1.0;
+        }
+    };
+
+    /// @param threads amount of threads tasks run on, including calling
+    ///        one, 0 means std::thread::hardware_concurrency().
+    explicit InitExecutor(unsigned threads = 0);
+
+    /// @brief Adds task of class, class is added to Hierarchy unless
+    /// it is registered already. Several tasks of the same class run one
+    /// after another, in order they have been added.
+    void add(const ClassInfo* cls, task_t task);
+
+    /// @brief Runs all added tasks and forgets them.
+    ///
+    /// If some task throws, no more tasks are started, already running
+    /// ones are completed, and then first exception is rethrown.
+    report_t run();
+
+private:
+    unsigned threads;
+
+    std::vector<std::pair<const ClassInfo*, task_t>> tasks;
+};
+
+} // namespace myrtti
+
+#endif
@@ -0,0 +1,105 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRTTI_INSTANCE_STATS_H
+#define MYRTTI_INSTANCE_STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "myrtti/class_info.h"
+
+namespace myrtti {
+
+/// @brief Live instances and bytes accounting per class.
+///
+/// Instrumented builds (MYRTTI_INSTANCE_STATS defined, e.g.
+/// `myrtti_stats` target) count objects as they are constructed and
+/// destroyed. Object is counted for the class its construction has
+/// reached, so fully constructed object is counted for its most derived
+/// class only. Bytes are computed as amount of instances multiplied by
+/// class size (ClassInfo::size), so it is memory occupied by objects
+/// themselves, without memory they own.
+///
+/// Each thread updates its own counters, hot path never touches shared
+/// cache lines, and never takes locks.
+struct InstanceStats {
+
+    struct entry_t {
+        const ClassInfo* cls;
+
+        /// @brief Live instances of class itself.
+        int64_t instances;
+        int64_t bytes;
+
+        /// @brief Live instances of class and all its subclasses.
+        int64_t totalInstances;
+        int64_t totalBytes;
+    };
+
+    /// @return stats of class, rolled up over its subclasses.
+    static entry_t get(const ClassInfo* cls);
+
+    /// @return stats of all classes with live instances (including
+    ///         subclasses instances), biggest total bytes first.
+    static std::vector<entry_t> snapshot();
+};
+
+namespace details {
+    /// @brief Live instances counters of single thread, by class dense
+    /// index. Only owner thread writes counters, others may read them.
+    struct InstanceCounters {
+        std::atomic<int64_t>* counts = nullptr;
+        std::size_t capacity = 0;
+
+        void add(const ClassInfo* cls, int64_t delta) {
+            uint32_t i = cls->getIndex();
+            if (/*[[likely]]*/ i < capacity && cls->isRegistered()) {
+                auto& c = counts[i];
+                c.store(c.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+            } else {
+                addSlow(cls, delta);
+            }
+        }
+
+        /// @brief Registers class if needed, and grows counters.
+        void addSlow(const ClassInfo* cls, int64_t delta);
+    };
+
+    /// @brief Counters of current thread, created on first use.
+    inline thread_local InstanceCounters* threadInstanceCounters = nullptr;
+
+    InstanceCounters* attach_instance_counters();
+
+    /// @brief Moves instance from one class to another.
+    /// @param from class instance has been counted for, or nullptr
+    ///        if instance is being constructed.
+    /// @param to class instance should be counted for, or nullptr
+    ///        if instance is being destroyed.
+    inline void count_instance(const ClassInfo* from, const ClassInfo* to) {
+        InstanceCounters* counters = threadInstanceCounters;
+        if (/*[[unlikely]]*/ !counters)
+            counters = attach_instance_counters();
+        if (from)
+            counters->add(from, -1);
+        if (to)
+            counters->add(to, 1);
+    }
+}
+
+} // namespace myrtti
+
+#endif
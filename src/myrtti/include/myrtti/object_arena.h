@@ -0,0 +1,73 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRTTI_OBJECT_ARENA_H
+#define MYRTTI_OBJECT_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "myrtti/class_info.h"
+
+namespace myrtti {
+
+/// @brief Storage of objects created by class factories (see
+/// ClassInfo::createInstance).
+///
+/// Each class gets its own pool of fixed size blocks, chunks of pool
+/// grow geometrically, and released blocks are reused by subsequent
+/// objects of the same class. So once pools are warmed up, creation
+/// doesn't touch general heap.
+///
+/// Arena is not thread safe. Threads are supposed to have arenas of
+/// their own, so they don't contend for allocator.
+struct ObjectArena {
+    ObjectArena();
+
+    /// @brief Releases pools, all objects should be destroyed before.
+    ~ObjectArena();
+
+    ObjectArena(const ObjectArena&) = delete;
+    ObjectArena& operator=(const ObjectArena&) = delete;
+
+    /// @brief Creates object of class, see ClassInfo::createInstance.
+    Object* create(const ClassInfo* cls);
+
+    /// @brief Destroys object created in this arena.
+    void destroy(Object* o);
+
+    /// @brief Allocates storage for object of given class.
+    void* allocate(const ClassInfo* cls);
+
+    /// @brief Releases storage allocated by allocate.
+    void deallocate(const ClassInfo* cls, void* storage);
+
+    /// @return amount of allocated blocks.
+    std::size_t size() const { return live; }
+
+private:
+    struct Pool;
+
+    Pool& getPool(const ClassInfo* cls);
+
+    /// @brief Pools by class index (see ClassInfo::getIndex).
+    std::vector<std::unique_ptr<Pool>> pools;
+
+    std::size_t live = 0;
+};
+
+} // namespace myrtti
+
+#endif
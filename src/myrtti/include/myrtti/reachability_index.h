@@ -0,0 +1,98 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRTTI_REACHABILITY_INDEX_H
+#define MYRTTI_REACHABILITY_INDEX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "utils/span.h"
+
+namespace myrtti {
+
+/// @brief Answers whether one node of DAG reaches another one through
+/// parent edges, in near constant time. Nodes are given by dense index.
+///
+/// Nodes are numbered in post order of spanning forest, which is walked
+/// from roots down to children. Each node is labeled with post numbers
+/// of all nodes which reach it, as sorted list of intervals: tree
+/// descendants make a single interval, other ones add few more. So
+/// query is a binary search among few intervals. If list gets bigger
+/// than bitset of all nodes would be, node is labeled with bitset.
+///
+/// Labels of node are merged from labels of its children, so nodes of
+/// the same height (longest distance to leaf) are labeled
+/// independently, and big levels are split between threads.
+struct ReachabilityIndex {
+    /// @param parentsBegin parents of node i are
+    ///        parents[parentsBegin[i] .. parentsBegin[i + 1])
+    /// @param parents direct parents of all nodes
+    /// @param threads amount of threads index is built with
+    ReachabilityIndex(
+        span<const uint32_t> parentsBegin,
+        span<const uint32_t> parents,
+        unsigned threads = 1
+    );
+
+    /// @return true if `to` is `from` or one of its ancestors.
+    bool reaches(uint32_t from, uint32_t to) const {
+        if (from >= post.size() || to >= post.size())
+            return false;
+
+        uint32_t p = post[from];
+        const label_t& label = labels[to];
+        if (label.kind == kind_bitset)
+            return (bits[label.offset + p / 64] >> (p % 64)) & 1;
+
+        const interval_t* first = intervals.data() + label.offset;
+        const interval_t* last = first + label.size;
+        const interval_t* next = std::upper_bound(
+            first, last, p,
+            [](uint32_t p, const interval_t& i) { return p < i.low; }
+        );
+        return next != first && p <= next[-1].high;
+    }
+
+    /// @return heap memory taken by index.
+    std::size_t memoryUsage() const;
+
+private:
+    struct interval_t {
+        uint32_t low;
+        uint32_t high;
+    };
+
+    static constexpr uint32_t kind_intervals = 0;
+    static constexpr uint32_t kind_bitset = 1;
+
+    struct label_t {
+        uint32_t kind;
+        uint32_t size;
+        std::size_t offset;
+    };
+
+    /// @brief Post order numbers, by node index.
+    std::vector<uint32_t> post;
+
+    std::vector<label_t> labels;
+    std::vector<interval_t> intervals;
+    std::vector<uint64_t> bits;
+};
+
+} // namespace myrtti
+
+#endif
@@ -22,12 +22,28 @@
 
 #include "myrtti/class_id.h"
 #include "myrtti/class_info.h"
-#include "myrtti/hierarchy.h"
 
-#include <array>
+#ifdef MYRTTI_CAST_PROFILE
+#include "myrtti/cast_profile.h"
+#define MYRTTI_RECORD_CAST(from, to) ::myrtti::CastProfile::instance()->record(from, to)
+#else
+#define MYRTTI_RECORD_CAST(from, to)
+#endif
+
+#ifdef MYRTTI_CAST_LAYOUT
+#include "myrtti/cast_layout.h"
+#endif
+
+#ifdef MYRTTI_INSTANCE_STATS
+#include "myrtti/instance_stats.h"
+#define MYRTTI_COUNT_INSTANCE(from, to) ::myrtti::details::count_instance(from, to)
+#else
+#define MYRTTI_COUNT_INSTANCE(from, to)
+#endif
+
 #include <cstdlib>
 #include <iosfwd>
-#include <iostream>
+#include <new>
 #include <utility>
 
 #ifndef CROSS_PTRS_UNORDERED_MAP
@@ -38,6 +54,11 @@
 
 #include <type_traits>
 
+#if defined(CROSS_PTRS_UNORDERED_MAP) && defined(DEBUG_REPORT_CROSS_PTRS)
+#include <iostream>
+#include "myrtti/hierarchy.h"
+#endif
+
 #if defined(__clang__) || defined(__GNUG__)
 #define MYRTTI_INLINE inline __attribute__((always_inline))
 #elif defined(_MSC_VER)
@@ -49,10 +70,24 @@
 
 namespace myrtti
 {
+namespace details {
+    struct CrossPtrsLayout;
+
+    /// @brief Object being constructed by construct_n in current thread,
+    /// given by its Object subobject. RTTI constructors of this very
+    /// object don't fill crossPtrs, it is done by CrossPtrsLayout::stamp
+    /// once object is constructed. Other objects created meanwhile (its
+    /// members, temporaries) fill crossPtrs as usual.
+    inline thread_local const Object* stampedObject = nullptr;
+}
+
 struct Object {
-    virtual ~Object() = default;
+    virtual ~Object() {
+        MYRTTI_COUNT_INSTANCE(rtti, nullptr);
+    }
 
     Object() {
+        MYRTTI_COUNT_INSTANCE(nullptr, rtti);
         reportCrossPtrs();
     }
 
@@ -61,13 +96,21 @@ struct Object {
         return myId;
     }
     static const ClassInfo* info() {
-        static ClassInfo v("myrtti::Object", class_id());
+        static ClassInfo v("myrtti::Object", class_id(), sizeof(Object));
+        MYRTTI_REGISTER_CLASS(Object);
         return &v;
     }
 
     // We intentinally keep rtti field public:
     const ClassInfo* rtti = info();
 
+    /// @brief Container of cross pointers, by class id of subobject.
+    #ifndef CROSS_PTRS_UNORDERED_MAP
+    using cross_ptrs_t = std::map<class_id_t, void*>;
+    #else
+    using cross_ptrs_t = std::unordered_map<class_id_t, void*>;
+    #endif
+
     void reportCrossPtrs() {
         #if defined(CROSS_PTRS_UNORDERED_MAP) && defined(DEBUG_REPORT_CROSS_PTRS)
         std::size_t bc = crossPtrs.bucket_count();
@@ -117,9 +160,10 @@ struct Object {
     template<class T, std::enable_if_t<!std::is_pointer_v<T>, bool> = true>
     MYRTTI_INLINE const T& cast() const {
         using TT = std::remove_reference_t<T>;
-        auto found = this->crossPtrs.find(TT ::class_id());
-        if (/*[[likely]]*/ found != end(this->crossPtrs)) {
-            return *static_cast<TT*>(found->second);
+        MYRTTI_RECORD_CAST(rtti, TT::info());
+        void* found = findCrossPtr(TT::class_id());
+        if (/*[[likely]]*/ found) {
+            return *static_cast<TT*>(found);
         }
         // Unable to cast, unable to return null, panic.
         abort();
@@ -128,16 +172,67 @@ struct Object {
     template<class T, std::enable_if_t<std::is_pointer_v<T>, bool> = true>
     MYRTTI_INLINE T cast() const {
         using TT = std::remove_pointer_t<T>;
-        auto found = this->crossPtrs.find(TT::class_id());
-        if (found != end(this->crossPtrs))
-            return static_cast<T>(found->second);
-        return nullptr;
+        MYRTTI_RECORD_CAST(rtti, TT::info());
+        return static_cast<T>(findCrossPtr(TT::class_id()));
     }
 
 protected:
     template<class T>
     friend struct RTTI;
 
+    friend struct details::CrossPtrsLayout;
+
+    /// @brief Looks for pointer to given class subobject.
+    /// @return subobject pointer or nullptr.
+    MYRTTI_INLINE void* findCrossPtr(class_id_t target) const {
+        #ifdef MYRTTI_CAST_LAYOUT
+        // Profile-guided path, see CastLayout. Table is loaded again
+        // within guard, so it is not released until cast is finished.
+        // Load is ordered after guard, as setCastLayout stores are
+        // ordered before its wait for guards.
+        if (rtti->castTable.load(std::memory_order_relaxed)) {
+            details::CastTableGuard guard;
+            if (const CastTable* table = rtti->castTable.load(std::memory_order_seq_cst))
+                return findCrossPtr(target, table);
+        }
+        #endif
+        return findInCrossPtrs(target);
+    }
+
+    #ifdef MYRTTI_CAST_LAYOUT
+    /// @brief Looks for subobject through cast table. Offsets are valid
+    /// only for dynamic type they have been learned for, so we compare
+    /// vptrs.
+    MYRTTI_INLINE void* findCrossPtr(class_id_t target, const CastTable* table) const {
+        const void* vptr = *reinterpret_cast<const void* const*>(this);
+        const CastTable::entry_t* entry = table->find(target);
+        if (!entry)
+            return findInCrossPtrs(target);
+
+        std::ptrdiff_t offset = entry->offset.load(std::memory_order_acquire);
+        if (offset != CastTable::unknown_offset
+            && entry->vptr.load(std::memory_order_relaxed) == vptr) {
+            if (offset == CastTable::not_a_base)
+                return nullptr;
+            auto* self = const_cast<char*>(reinterpret_cast<const char*>(this));
+            return self + offset;
+        }
+
+        void* res = findInCrossPtrs(target);
+        entry->learn(
+            vptr,
+            res ? static_cast<char*>(res) - reinterpret_cast<const char*>(this)
+                : CastTable::not_a_base
+        );
+        return res;
+    }
+    #endif
+
+    MYRTTI_INLINE void* findInCrossPtrs(class_id_t target) const {
+        auto found = crossPtrs.find(target);
+        return found != end(crossPtrs) ? found->second : nullptr;
+    }
+
     template<class T, class From>
     friend T try_static_cast(From* from);
 
@@ -147,11 +242,7 @@ protected:
     //    so far we have switched to std::map for it seems to be more stable,
     //    showing similar results for our case.
 
-    #ifndef CROSS_PTRS_UNORDERED_MAP
-    std::map<class_id_t, void*> crossPtrs{{class_id(), this}};
-    #else
-    std::unordered_map<class_id_t, void*> crossPtrs{{class_id(), this}};
-    #endif
+    cross_ptrs_t crossPtrs{{class_id(), this}};
 };
 
 // Problems:
@@ -171,12 +262,33 @@ template <class Class>
 struct RTTI : virtual Object {
     RTTI() {
         auto *superSelf = static_cast<Class*>(this);
+        MYRTTI_COUNT_INSTANCE(this->rtti, Class::info());
         this->rtti = Class::info();
-        this->crossPtrs[Class::class_id()] = superSelf;
+        // Object might be created before its class is registered, e.g.
+        // by static initializer of another translation unit.
+        this->rtti->ensureRegistered();
+        if (/*[[likely]]*/ !details::stampedObject
+            || details::stampedObject != static_cast<Object*>(this))
+            this->crossPtrs[Class::class_id()] = superSelf;
         reportCrossPtrs();
     }
 };
 
+namespace details {
+    template<class ClassT>
+    struct factory_thunks {
+        static Object* construct(void* storage) {
+            return new (storage) ClassT();
+        }
+
+        static void destroy(void* storage) {
+            static_cast<ClassT*>(storage)->~ClassT();
+        }
+
+        static constexpr ClassInfo::factory_t value{alignof(ClassT), &construct, &destroy};
+    };
+}
+
 template<class T>
 using strip_type = std::remove_pointer_t<
     std::remove_const_t<
@@ -187,16 +299,27 @@ using strip_type = std::remove_pointer_t<
 template<class B, class T>
 using is_base_of = std::is_base_of<strip_type<B>, strip_type<T>>;
 
+// Class id source, it might be overridden, e.g. if class names are
+// unique, ids could be made of names only. See also
+// MYRTTI_BUILD_STABLE_IDS cmake option.
+#ifndef MYRTTI_UNIQUE_NAME
 #define MYRTTI_UNIQUE_NAME(cn) #cn, __FILE__, __LINE__
+#endif
 
 #define DEFINE_RTTI(cn, ...)                                       \
     static MYRTTI_INLINE constexpr myrtti::class_id_t class_id() { \
         constexpr myrtti::class_id_t myId{MYRTTI_UNIQUE_NAME(cn)}; \
         return myId;                                               \
     }                                                              \
-    static const ::myrtti::ClassInfo* info() {                                                         \
-        static std::unique_ptr<myrtti::ClassInfo> p = myrtti::ClassInfo::create<cn, __VA_ARGS__>(#cn); \
-        return p.get();                                                                                \
+    static const ::myrtti::ClassInfo* info() {                     \
+        using parents = ::myrtti::details::parents_t<__VA_ARGS__>; \
+        static ::myrtti::ClassInfo v(                              \
+            #cn, class_id(),                                       \
+            parents::ids, parents::infos, parents::size,           \
+            sizeof(cn), ::myrtti::details::factory_of<cn>()        \
+        );                                                         \
+        MYRTTI_REGISTER_CLASS(cn);                                 \
+        return &v;                                                 \
     }
 
 #define MYRTTI_ESC(...) __VA_ARGS__
@@ -267,7 +390,8 @@ MYRTTI_INLINE T try_static_cast(From* from) {
     // TODO: for debug modes also add verification whether there is straight static (non-virtual) inheritance line
     //   between From and To.
     using TT = std::remove_pointer_t<T>;
-    if (from->crossPtrs.count(TT::class_id()))
+    MYRTTI_RECORD_CAST(from->rtti, TT::info());
+    if (from->findCrossPtr(TT::class_id()))
         return static_cast<T>(from);
     return nullptr;
 }
@@ -13,14 +13,16 @@
 // limitations under the License.
 
 #include "myrtti/runtime.h"
-#include "myrtti/hierarchy.h"
+#include "myrtti/class_set_index.h"
 
-#include <iostream>
 #include <functional>
+#include <memory>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #if 0
+#include <iostream>
 #define TRACE std::cout
 #else
 #include "utils/nullout.h"
@@ -59,6 +61,9 @@ namespace myrtti
     /// );
     /// visitor.visit(ExceptionErrorTwo());
     ///
+    /// Handler is looked up by ClassSetIndex, so visit costs a single
+    /// lookup, whatever the depth of hierarchy is. Ancestors are walked
+    /// only if handler refuses object.
     template<bool immutable = true>
     struct Visitor {
         using object_ref = std::conditional_t<immutable, const Object&, Object&>;
@@ -87,8 +92,8 @@ namespace myrtti
                     );
                     TRACE << "VISITOR: Registered handler for "
                               << Cls::info() << "\n";
-                    visitorsMap.emplace(
-                        Cls::class_id(),
+                    handlerIds.push_back(Cls::class_id());
+                    handlers.emplace_back(
                         [=] (object_ref b) {
                             Cls& bb = b.template cast<Cls>();
                             return visitors(bb);
@@ -96,40 +101,49 @@ namespace myrtti
                     );
                 } (), ...
             );
+            index = std::make_unique<ClassSetIndex>(
+                span<const class_id_t>(handlerIds.data(), handlerIds.size())
+            );
         }
 
     bool visit(object_ref b) {
         TRACE << "VISITOR: Unwinding visit for class "
                   << b.rtti->name << "\n";
 
-        bool neverVisited = Hierarchy::instance()->unwind(
-            b.rtti->getId(),
-            [&](const ClassInfo *cls) {
-                TRACE << std::hex
-                << "VISITOR:   Visiting class " << cls << "\n";
-                auto found = visitorsMap.find(cls->getId());
-
-                if (found != end(visitorsMap)) {
-                    TRACE << "VISITOR:     found handler...\n";
-
-                    bool visitHandled = found->second(b);
-                    // If visit was successfull, stop going through
-                    // hierarchy and exit.
-                    return !visitHandled;
-                }
-                TRACE << "VISITOR:     handler not found.\n";
+        uint32_t pos = index->find(b.rtti);
+        if (pos == ClassSetIndex::npos) {
+            TRACE << "VISITOR:     handler not found.\n";
+            return false;
+        }
 
+        TRACE << "VISITOR:     found handler...\n";
+
+        // If visit was successfull, stop going through
+        // hierarchy and exit.
+        if (handlers[pos](b))
+            return true;
+
+        // Handler refused, go on with the rest of ancestors. The
+        // first handler met in unwind order is the one just called.
+        bool skipped = false;
+        for (const ClassInfo *cls : unwind_order(b.rtti)) {
+            TRACE << std::hex
+            << "VISITOR:   Visiting class " << cls << "\n";
+            pos = index->position(cls->getId());
+            if (pos == ClassSetIndex::npos || !std::exchange(skipped, true))
+                continue;
+
+            TRACE << "VISITOR:     found handler...\n";
+            if (handlers[pos](b))
                 return true;
-            }
-        );
-        return !neverVisited;
+        }
+        return false;
     }
 
     private:
-        std::unordered_map<
-            class_id_t,
-            std::function<bool(object_ref b)>
-        > visitorsMap;
+        std::vector<class_id_t> handlerIds;
+        std::vector<std::function<bool(object_ref b)>> handlers;
+        std::unique_ptr<ClassSetIndex> index;
     };
 
     /// @brief Implements visiting for "static" case. Given particular
@@ -166,37 +180,55 @@ namespace myrtti
         explicit VisitorStatic(
             const std::unordered_map<
                 class_id_t, std::function<bool()>
-            >& handlers
-        ) : visitorsMap(handlers) {}
+            >& handlersMap
+        ) {
+            for (const auto& [id, handler] : handlersMap) {
+                handlerIds.push_back(id);
+                handlers.push_back(handler);
+            }
+            index = std::make_unique<ClassSetIndex>(
+                span<const class_id_t>(handlerIds.data(), handlerIds.size())
+            );
+        }
 
         template<class ClassT>
         bool visit() {
             TRACE << "STATIC VISITOR: Unwinding visit for class " << ClassT::info() << "\n";
 
-            bool neverVisited = Hierarchy::instance()->unwind(
-                ClassT::class_id(),
-                [&](const ClassInfo *cls) {
-                    TRACE << std::hex
-                    << "STATIC VISITOR:   Visiting class " << cls << "\n";
-                    auto found = visitorsMap.find(cls->getId());
+            const ClassInfo* info = ClassT::info();
+
+            uint32_t pos = index->find(info);
+            if (pos == ClassSetIndex::npos) {
+                TRACE << "STATIC VISITOR:     handler not found.\n";
+                return false;
+            }
+
+            TRACE << "STATIC VISITOR:     found handler...\n";
 
-                    if (found != end(visitorsMap)) {
-                        TRACE << "STATIC VISITOR:     found handler...\n";
+            // If visit was successfull, stop going through
+            // hierarchy and exit.
+            if (handlers[pos]())
+                return true;
 
-                        bool visitHandled = found->second();
-                        // If visit was successfull, stop going through
-                        // hierarchy and exit.
-                        return !visitHandled;
-                    }
-                    TRACE << "STATIC VISITOR:     handler not found.\n";
+            // See Visitor::visit.
+            bool skipped = false;
+            for (const ClassInfo *cls : unwind_order(info)) {
+                TRACE << std::hex
+                << "STATIC VISITOR:   Visiting class " << cls << "\n";
+                pos = index->position(cls->getId());
+                if (pos == ClassSetIndex::npos || !std::exchange(skipped, true))
+                    continue;
 
+                TRACE << "STATIC VISITOR:     found handler...\n";
+                if (handlers[pos]())
                     return true;
-                }
-            );
-            return !neverVisited;
+            }
+            return false;
         }
 
     private:
-        std::unordered_map<class_id_t, std::function<bool()>> visitorsMap;
+        std::vector<class_id_t> handlerIds;
+        std::vector<std::function<bool()>> handlers;
+        std::unique_ptr<ClassSetIndex> index;
     };
 } // namespace myrtti
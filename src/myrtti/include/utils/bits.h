@@ -0,0 +1,52 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRTTI_BITS_H
+#define MYRTTI_BITS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace myrtti {
+    /// @brief Index of lowest set bit, value should not be zero.
+    /// (std::countr_zero replacement, for we stick to C++17).
+    inline unsigned countr_zero(uint64_t value) {
+#if defined(__clang__) || defined(__GNUG__)
+        return __builtin_ctzll(value);
+#elif defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return index;
+#else
+        unsigned n = 0;
+        for (; !(value & 1); value >>= 1)
+            ++n;
+        return n;
+#endif
+    }
+
+    /// @brief Calls fn for index of each set bit, in ascending order.
+    template<typename FnT>
+    void for_each_bit(const uint64_t* words, std::size_t size, FnT&& fn) {
+        for (std::size_t w = 0; w != size; ++w) {
+            for (uint64_t word = words[w]; word; word &= word - 1)
+                fn(w * 64 + countr_zero(word));
+        }
+    }
+}
+#endif
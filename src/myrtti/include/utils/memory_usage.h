@@ -0,0 +1,151 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRTTI_MEMORY_USAGE_H
+#define MYRTTI_MEMORY_USAGE_H
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace myrtti {
+    /// @brief Allocator which counts bytes allocated through it, used to
+    /// measure actual layout of standard containers.
+    template<typename T>
+    struct counting_allocator {
+        using value_type = T;
+
+        explicit counting_allocator(std::size_t* bytes) : bytes(bytes) {}
+
+        template<typename U>
+        counting_allocator(const counting_allocator<U>& src) : bytes(src.bytes) {}
+
+        T* allocate(std::size_t n) {
+            *bytes += n * sizeof(T);
+            return std::allocator<T>().allocate(n);
+        }
+
+        void deallocate(T* p, std::size_t n) {
+            *bytes -= n * sizeof(T);
+            std::allocator<T>().deallocate(p, n);
+        }
+
+        template<typename U>
+        bool operator==(const counting_allocator<U>& rhs) const { return bytes == rhs.bytes; }
+
+        template<typename U>
+        bool operator!=(const counting_allocator<U>& rhs) const { return bytes != rhs.bytes; }
+
+        std::size_t* bytes;
+    };
+
+    namespace details {
+        template<typename C>
+        struct counted_container;
+
+        template<typename K, typename V, typename Cmp, typename A>
+        struct counted_container<std::map<K, V, Cmp, A>> {
+            using type = std::map<K, V, Cmp, counting_allocator<std::pair<const K, V>>>;
+        };
+
+        template<typename K, typename V, typename H, typename Eq, typename A>
+        struct counted_container<std::unordered_map<K, V, H, Eq, A>> {
+            using type = std::unordered_map<K, V, H, Eq, counting_allocator<std::pair<const K, V>>>;
+        };
+
+        template<typename K, typename V, typename H, typename Eq, typename A>
+        struct counted_container<std::unordered_multimap<K, V, H, Eq, A>> {
+            using type = std::unordered_multimap<K, V, H, Eq, counting_allocator<std::pair<const K, V>>>;
+        };
+
+        template<typename K, typename H, typename Eq, typename A>
+        struct counted_container<std::unordered_set<K, H, Eq, A>> {
+            using type = std::unordered_set<K, H, Eq, counting_allocator<K>>;
+        };
+
+        template<typename C, typename = void>
+        struct is_map : std::false_type {};
+
+        template<typename C>
+        struct is_map<C, std::void_t<typename C::mapped_type>> : std::true_type {};
+
+        template<typename C, typename = void>
+        struct is_hashed : std::false_type {};
+
+        template<typename C>
+        struct is_hashed<C, std::void_t<decltype(std::declval<C>().bucket_count())>>
+        : std::true_type {};
+    }
+
+    /// @brief Node based container C (std::map, std::unordered_map,
+    /// etc.) which counts bytes it allocates.
+    template<typename C>
+    using counted_container_t = typename details::counted_container<C>::type;
+
+    /// @return heap memory taken by node based container itself, without
+    ///         memory owned by its items. Sizes of node and bucket are
+    ///         measured by inserting item into probe container, so they
+    ///         are actual ones of standard library in use.
+    template<typename C>
+    std::size_t node_container_bytes(const C& c) {
+        using probe_t = counted_container_t<C>;
+        using allocator_t = typename probe_t::allocator_type;
+
+        std::size_t res = 0;
+
+        if constexpr (details::is_hashed<C>::value) {
+            std::size_t buckets = 0;
+            probe_t probe{allocator_t(&buckets)};
+            // Buckets of empty container might be kept inline.
+            if (probe.bucket_count() != c.bucket_count())
+                probe.rehash(c.bucket_count());
+            res += buckets / probe.bucket_count() * c.bucket_count();
+        }
+
+        if (!c.empty()) {
+            std::size_t node = 0;
+            probe_t probe{allocator_t(&node)};
+            if constexpr (details::is_hashed<C>::value)
+                probe.rehash(16);
+            std::size_t empty = node;
+            // Node doesn't depend on value, so mapped value is default
+            // constructed, which works for move only values too.
+            if constexpr (details::is_map<C>::value) {
+                probe.emplace(
+                    std::piecewise_construct,
+                    std::forward_as_tuple(c.begin()->first),
+                    std::forward_as_tuple()
+                );
+            } else {
+                probe.insert(*c.begin());
+            }
+            res += (node - empty) * c.size();
+        }
+
+        return res;
+    }
+
+    /// @return heap memory taken by vector itself.
+    template<typename T, typename A>
+    std::size_t vector_bytes(const std::vector<T, A>& v) {
+        return v.capacity() * sizeof(T);
+    }
+}
+#endif
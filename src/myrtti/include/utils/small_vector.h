@@ -0,0 +1,78 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRTTI_SMALL_VECTOR_H
+#define MYRTTI_SMALL_VECTOR_H
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace myrtti {
+    /// @brief Vector of trivially copyable items, first N of them are
+    /// stored inline, so short sequences (e.g. traversal stacks) don't
+    /// touch heap. Once it is exceeded, items are moved to heap buffer,
+    /// which grows geometrically.
+    template<typename T, std::size_t N>
+    struct SmallVector {
+        static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable.");
+        static_assert(std::is_trivially_destructible_v<T>, "T must be trivially destructible.");
+
+        SmallVector() = default;
+
+        SmallVector(const SmallVector&) = delete;
+        SmallVector& operator=(const SmallVector&) = delete;
+
+        T* begin() { return items; }
+        T* end() { return items + n; }
+        const T* begin() const { return items; }
+        const T* end() const { return items + n; }
+
+        std::size_t size() const { return n; }
+        bool empty() const { return n == 0; }
+
+        T& operator[](std::size_t i) { return items[i]; }
+        const T& operator[](std::size_t i) const { return items[i]; }
+
+        T& back() { return items[n - 1]; }
+
+        void push_back(const T& v) {
+            if (/*[[unlikely]]*/ n == capacity)
+                grow();
+            new (items + n++) T(v);
+        }
+
+        void pop_back() { --n; }
+
+        void clear() { n = 0; }
+
+    private:
+        void grow() {
+            capacity *= 2;
+            std::unique_ptr<unsigned char[]> buffer(new unsigned char[capacity * sizeof(T)]);
+            std::memcpy(buffer.get(), static_cast<const void*>(items), n * sizeof(T));
+            heap = std::move(buffer);
+            items = reinterpret_cast<T*>(heap.get());
+        }
+
+        alignas(T) unsigned char inlineItems[N * sizeof(T)];
+        T* items = reinterpret_cast<T*>(inlineItems);
+        std::size_t n = 0;
+        std::size_t capacity = N;
+        std::unique_ptr<unsigned char[]> heap;
+    };
+}
+#endif
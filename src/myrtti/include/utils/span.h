@@ -0,0 +1,45 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRTTI_SPAN_H
+#define MYRTTI_SPAN_H
+
+#include <cstddef>
+
+namespace myrtti {
+    /// @brief Minimal std::span replacement, for we stick to C++17.
+    template<typename T>
+    struct span {
+        constexpr span() = default;
+        constexpr span(T* data, std::size_t size) : ptr(data), len(size) {}
+
+        constexpr T* begin() const { return ptr; }
+        constexpr T* end() const { return ptr + len; }
+        constexpr T* data() const { return ptr; }
+        constexpr std::size_t size() const { return len; }
+        constexpr bool empty() const { return len == 0; }
+        constexpr T& operator[](std::size_t i) const { return ptr[i]; }
+
+    private:
+        T* ptr = nullptr;
+        std::size_t len = 0;
+    };
+
+    template<typename T>
+    constexpr T* begin(const span<T>& s) { return s.begin(); }
+
+    template<typename T>
+    constexpr T* end(const span<T>& s) { return s.end(); }
+}
+#endif
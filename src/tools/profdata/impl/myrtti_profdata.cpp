@@ -0,0 +1,86 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Offline tool for profile-guided cast layout.
+//
+// Usage:
+//   myrtti_profdata merge  -o <out.profile> <in.profile>...
+//   myrtti_profdata layout -o <out.layout>  <in.profile>...
+//   myrtti_profdata header -o <out.h>       <in.profile>...
+//
+// * merge  - sums up several profiles into one.
+// * layout - builds cast tables, to be loaded at startup with
+//            CastLayout::load and Hierarchy::setCastLayout.
+// * header - same as layout, but emits C++ header which applies
+//            tables during static initialization.
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "myrtti/cast_layout.h"
+#include "myrtti/cast_profile.h"
+
+using namespace std;
+using namespace myrtti;
+
+namespace {
+    int usage() {
+        cerr << "Usage:\n"
+             << "  myrtti_profdata merge  -o <out.profile> <in.profile>...\n"
+             << "  myrtti_profdata layout -o <out.layout>  <in.profile>...\n"
+             << "  myrtti_profdata header -o <out.h>       <in.profile>...\n";
+        return 1;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 5 || string(argv[2]) != "-o")
+        return usage();
+
+    string command = argv[1];
+    string output = argv[3];
+    vector<string> inputs(argv + 4, argv + argc);
+
+    try {
+        CastProfile profile;
+        for (const auto& input : inputs) {
+            ifstream in(input);
+            if (!in)
+                throw runtime_error("Unable to open " + input);
+            profile.load(in);
+        }
+
+        ofstream out(output);
+        if (!out)
+            throw runtime_error("Unable to open " + output);
+
+        if (command == "merge")
+            profile.save(out);
+        else if (command == "layout")
+            CastLayout::build(profile)->save(out);
+        else if (command == "header")
+            CastLayout::build(profile)->emitHeader(out);
+        else
+            return usage();
+
+    } catch (const exception& e) {
+        cerr << "myrtti_profdata: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
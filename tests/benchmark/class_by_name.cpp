@@ -0,0 +1,100 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Lookup of class by name among 10k classes: name index versus linear
+// scan of registered classes.
+
+#include "details/benchmarks_common.h"
+
+#include <myrtti/hierarchy.h>
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Named {
+        static constexpr std::size_t size = 10000;
+
+        std::vector<std::string> names;
+        std::vector<class_id_t> ids;
+        std::vector<std::unique_ptr<ClassInfo>> infos;
+
+        /// @brief Names to be looked up, as they would come from input.
+        std::vector<std::string> queries;
+
+        Named() {
+            names.reserve(size);
+            ids.reserve(size);
+            for (std::size_t i = 0; i != size; ++i) {
+                names.push_back("Named" + std::to_string(i));
+                ids.emplace_back(names[i].c_str());
+                infos.push_back(std::make_unique<ClassInfo>(names[i].c_str(), ids[i]));
+                Hierarchy::instance()->add(infos.back().get());
+            }
+
+            std::mt19937_64 rnd(1);
+            for (std::size_t i = 0; i != 1024; ++i)
+                queries.push_back(names[rnd() % size]);
+        }
+    };
+
+    Named& named() {
+        static Named n;
+        return n;
+    }
+
+    const ClassInfo* linearScan(const std::string& name) {
+        for (const auto& info : named().infos) {
+            if (name == info->name)
+                return info.get();
+        }
+        return nullptr;
+    }
+}
+
+static void classByName_index(benchmark::State& state) {
+    auto& n = named();
+    auto* h = Hierarchy::instance();
+    std::size_t q = 0;
+    for (auto _ : state) {
+        const std::string& name = n.queries[q++ % n.queries.size()];
+        benchmark::DoNotOptimize(h->getClassInfo(class_name_t(name)));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void classByName_constexpr(benchmark::State& state) {
+    named();
+    auto* h = Hierarchy::instance();
+    constexpr class_name_t name{"Named4242"};
+    for (auto _ : state)
+        benchmark::DoNotOptimize(h->getClassInfo(name));
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void classByName_linearScan(benchmark::State& state) {
+    auto& n = named();
+    std::size_t q = 0;
+    for (auto _ : state) {
+        const std::string& name = n.queries[q++ % n.queries.size()];
+        benchmark::DoNotOptimize(linearScan(name));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(classByName_index);
+BENCHMARK(classByName_constexpr);
+BENCHMARK(classByName_linearScan);
@@ -0,0 +1,59 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Nearest ancestor of class among set of handler classes: ClassSetIndex
+// versus walk over unwind order with hash map lookup for each ancestor,
+// which is how Visitor used to find handlers.
+
+#include "details/benchmarks_common.h"
+
+#include <myrtti/class_set_index.h>
+
+#include <unordered_map>
+
+template<class ClassT, class ...Members>
+void classSetIndex_index(benchmark::State& state) {
+    ClassSetIndex index{Members::class_id()...};
+    for (auto _ : state)
+        benchmark::DoNotOptimize(index.find(ClassT::info()));
+}
+
+template<class ClassT, class ...Members>
+void classSetIndex_walk(benchmark::State& state) {
+    std::unordered_map<class_id_t, uint32_t> members;
+    uint32_t pos = 0;
+    (members.emplace(Members::class_id(), pos++), ...);
+
+    for (auto _ : state) {
+        uint32_t found = ClassSetIndex::npos;
+        for (const ClassInfo* cls : unwind_order(ClassT::info())) {
+            auto it = members.find(cls->getId());
+            if (it != end(members)) {
+                found = it->second;
+                break;
+            }
+        }
+        benchmark::DoNotOptimize(found);
+    }
+}
+
+BENCHMARK_TEMPLATE(classSetIndex_index, DeepFinal, DeepRoot, WideRoot);
+BENCHMARK_TEMPLATE(classSetIndex_walk, DeepFinal, DeepRoot, WideRoot);
+
+BENCHMARK_TEMPLATE(classSetIndex_index, DeepFinal, DeepFinal, Deep10);
+BENCHMARK_TEMPLATE(classSetIndex_walk, DeepFinal, DeepFinal, Deep10);
+
+BENCHMARK_TEMPLATE(classSetIndex_index, WideFinal, WideRoot);
+BENCHMARK_TEMPLATE(classSetIndex_walk, WideFinal, WideRoot);
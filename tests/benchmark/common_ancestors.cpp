@@ -0,0 +1,69 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Most derived common bases of two classes: Hierarchy::commonAncestors
+// versus naive intersection of ancestor sets.
+
+#include "details/benchmarks_common.h"
+
+#include <myrtti/hierarchy.h>
+
+#include <unordered_set>
+#include <vector>
+
+static std::vector<const ClassInfo*> naiveCommonAncestors(class_id_t a, class_id_t b) {
+    auto* h = Hierarchy::instance();
+
+    std::unordered_set<const ClassInfo*> aAncestors;
+    h->windup(a, [&](const ClassInfo* cls) {
+        aAncestors.insert(cls);
+        return true;
+    });
+
+    std::vector<const ClassInfo*> common;
+    h->windup(b, [&](const ClassInfo* cls) {
+        if (aAncestors.count(cls))
+            common.push_back(cls);
+        return true;
+    });
+
+    std::vector<const ClassInfo*> res;
+    for (auto* c : common) {
+        bool mostDerived = true;
+        for (auto* other : common)
+            mostDerived = mostDerived && !h->isParent(other->getId(), c->getId());
+        if (mostDerived)
+            res.push_back(c);
+    }
+    return res;
+}
+
+template<class A, class B>
+void commonAncestors_index(benchmark::State& state) {
+    auto* h = Hierarchy::instance();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(h->commonAncestors(A::class_id(), B::class_id()));
+}
+
+template<class A, class B>
+void commonAncestors_naive(benchmark::State& state) {
+    for (auto _ : state)
+        benchmark::DoNotOptimize(naiveCommonAncestors(A::class_id(), B::class_id()));
+}
+
+BENCHMARK_TEMPLATE(commonAncestors_index, DeepFinal, Deep10);
+BENCHMARK_TEMPLATE(commonAncestors_naive, DeepFinal, Deep10);
+
+BENCHMARK_TEMPLATE(commonAncestors_index, WideFinal, DeepFinal);
+BENCHMARK_TEMPLATE(commonAncestors_naive, WideFinal, DeepFinal);
@@ -0,0 +1,102 @@
+# Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Compile time of class ids: generates translation unit with many RTTI
+# classes and compiles it with each class id hash policy (see
+# myrtti::id_hash). "none" policy returns constant, it is a baseline, so
+# the rest of compilation can be subtracted.
+
+import argparse
+from pathlib import Path
+import subprocess
+import sys
+import tempfile
+import time
+
+POLICIES = {
+    "none": "null_id_hash",
+    "crc64": "::myrtti::id_hash::crc64",
+    "wyhash": "::myrtti::id_hash::wyhash",
+}
+
+PRELUDE = """\
+#include <cstdint>
+
+struct null_id_hash {
+    template<typename ...Args>
+    constexpr uint64_t operator()(const char*, const Args&...) const noexcept {
+        return 0;
+    }
+};
+
+#include <myrtti.h>
+
+with_rtti_root(struct, CompileTimeRoot)
+with_rtti_end();
+"""
+
+
+def make_source(classes: int) -> str:
+    lines = [PRELUDE]
+    for i in range(classes):
+        # Names are long enough to be typical for namespaced classes.
+        lines.append(
+            f"with_rtti(struct, CompileTimeGeneratedClassNumber{i}, CompileTimeRoot)\n"
+            "with_rtti_end();\n"
+        )
+    return "\n".join(lines)
+
+
+def compile_once(compiler: str, include: Path, source: Path, policy: str) -> float:
+    cmd = [
+        compiler, "-std=c++17", "-fno-rtti", "-fsyntax-only",
+        f"-I{include}", f"-DMYRTTI_CLASS_ID_HASH={policy}", str(source),
+    ]
+    start = time.perf_counter()
+    subprocess.run(cmd, check=True)
+    return time.perf_counter() - start
+
+
+def main():
+    root = Path(__file__).resolve().parents[3]
+
+    parser = argparse.ArgumentParser(description="Compares compile time of class id hash policies.")
+    parser.add_argument("--compiler", default="c++")
+    parser.add_argument("--include", type=Path, default=root / "src/myrtti/include")
+    parser.add_argument("--classes", type=int, default=2000)
+    parser.add_argument("--repetitions", type=int, default=3)
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        source = Path(tmp) / "classes.cpp"
+        source.write_text(make_source(args.classes))
+
+        times = {}
+        for name, policy in POLICIES.items():
+            times[name] = min(
+                compile_once(args.compiler, args.include, source, policy)
+                for _ in range(args.repetitions)
+            )
+
+    baseline = times["none"]
+    print(f"{args.classes} classes, best of {args.repetitions}:")
+    for name, t in times.items():
+        hashing = t - baseline
+        print(f"  {name:8} {t * 1000:8.0f} ms"
+              f"  hashing {hashing * 1000:6.0f} ms"
+              f"  ({hashing / args.classes * 1e6:6.1f} us per class)")
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,81 @@
+# Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Build time impact of public headers: generates N translation units,
+# each of them includes header and defines a few RTTI classes, like
+# typical user code does. Reports per-TU compile time and size of
+# preprocessed TU.
+
+import argparse
+from pathlib import Path
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def make_source(header: str, tu: int, classes: int) -> str:
+    lines = [f"#include <{header}>\n", f"with_rtti_root(struct, Root{tu})\nwith_rtti_end();\n"]
+    for i in range(classes):
+        lines.append(
+            f"with_rtti(struct, Class{tu}_{i}, Root{tu})\n"
+            "with_rtti_end();\n"
+        )
+    lines.append(f"myrtti::Object* make{tu}() {{ return new Class{tu}_0; }}\n")
+    return "\n".join(lines)
+
+
+def main():
+    root = Path(__file__).resolve().parents[3]
+
+    parser = argparse.ArgumentParser(description="Measures build time impact of public headers.")
+    parser.add_argument("--compiler", default="c++")
+    parser.add_argument("--include", type=Path, default=root / "src/myrtti/include")
+    parser.add_argument("--header", action="append",
+                        help="header to measure, may be repeated (default: myrtti.h)")
+    parser.add_argument("--tus", type=int, default=20)
+    parser.add_argument("--classes", type=int, default=10, help="classes per TU")
+    parser.add_argument("--flags", default="-O0", help="extra compiler flags")
+    args = parser.parse_args()
+
+    headers = args.header or ["myrtti.h"]
+    base = [args.compiler, "-std=c++17", "-fno-rtti", f"-I{args.include}", *args.flags.split()]
+
+    with tempfile.TemporaryDirectory() as tmp:
+        for header in headers:
+            sources = []
+            for tu in range(args.tus):
+                source = Path(tmp) / f"tu{tu}.cpp"
+                source.write_text(make_source(header, tu, args.classes))
+                sources.append(source)
+
+            preprocessed = subprocess.run(
+                [*base, "-E", "-P", str(sources[0])],
+                check=True, capture_output=True
+            ).stdout
+
+            start = time.perf_counter()
+            for source in sources:
+                subprocess.run([*base, "-c", str(source), "-o", str(source.with_suffix(".o"))], check=True)
+            elapsed = time.perf_counter() - start
+
+            lines = preprocessed.count(b"\n")
+            print(f"{header}: {args.tus} TUs, {args.classes} classes each")
+            print(f"  per TU:        {elapsed / args.tus * 1000:8.0f} ms")
+            print(f"  preprocessed:  {len(preprocessed) / 1024:8.0f} KiB"
+                  f", {lines} lines")
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,65 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Construction throughput: plain `new T` in a loop versus bulk
+// construction (construct_n / make_many).
+
+#include "details/benchmarks_common.h"
+
+#include <myrtti/bulk.h>
+
+#include <vector>
+
+template<class T>
+void construction_new(benchmark::State& state) {
+    std::vector<T*> objects(state.range(0));
+    for (auto _ : state) {
+        for (auto& o : objects)
+            o = new T;
+        benchmark::DoNotOptimize(objects.data());
+        for (auto* o : objects)
+            delete o;
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template<class T>
+void construction_constructN(benchmark::State& state) {
+    std::size_t n = state.range(0);
+    void* storage = ::operator new(sizeof(T) * n, std::align_val_t(alignof(T)));
+    for (auto _ : state) {
+        T* objects = myrtti::construct_n<T>(storage, n);
+        benchmark::DoNotOptimize(objects);
+        myrtti::destroy_n(objects, n);
+    }
+    ::operator delete(storage, std::align_val_t(alignof(T)));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template<class T>
+void construction_makeMany(benchmark::State& state) {
+    for (auto _ : state) {
+        auto batch = myrtti::make_many<T>(state.range(0));
+        benchmark::DoNotOptimize(batch.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_TEMPLATE(construction_new, DeepFinal)->Arg(1000)->Arg(100000);
+BENCHMARK_TEMPLATE(construction_constructN, DeepFinal)->Arg(1000)->Arg(100000);
+BENCHMARK_TEMPLATE(construction_makeMany, DeepFinal)->Arg(1000)->Arg(100000);
+
+BENCHMARK_TEMPLATE(construction_new, WideFinal)->Arg(1000)->Arg(100000);
+BENCHMARK_TEMPLATE(construction_constructN, WideFinal)->Arg(1000)->Arg(100000);
+BENCHMARK_TEMPLATE(construction_makeMany, WideFinal)->Arg(1000)->Arg(100000);
@@ -0,0 +1,175 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Deep first walk over DAG: templated walk with explicit stack versus
+// recursive walk with std::function callbacks and std::bind'ed member
+// function pointers, which is how DAG::dfs used to work. Reachability
+// queries are measured with and without reachability index.
+
+#include "details/benchmarks_common.h"
+
+#include <myrtti/dag.h>
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+    using node_t = uint64_t;
+    using nodes_t = std::vector<node_t>;
+
+    /// @brief Graph and walk as DAG used to have them.
+    struct RecursiveDAG {
+        using node_callback_t = std::function<bool(node_t)>;
+
+        void add(node_t node, const nodes_t& parents) {
+            if (!parents.empty())
+                incomingEdges.emplace(node, parents);
+        }
+
+        bool dfs(node_t startNode, const node_callback_t& onBeforeNode, const node_callback_t& onAfterNode) const {
+            std::unordered_set<node_t> visited;
+            return dfsRecursive(visited, startNode, &nodes_t::cbegin, &nodes_t::cend, onBeforeNode, onAfterNode);
+        }
+
+    private:
+        template <typename ItPtrs>
+        bool dfsRecursive(
+            std::unordered_set<node_t>& visited,
+            node_t curNode,
+            ItPtrs beginPtr,
+            ItPtrs endPtr,
+            const node_callback_t& onBeforeNode,
+            const node_callback_t& onAfterNode
+        ) const {
+            if (!visited.insert(curNode).second)
+                return true;
+
+            if (onBeforeNode && !onBeforeNode(curNode))
+                return false;
+
+            auto incomingIt = incomingEdges.find(curNode);
+            if (incomingIt != end(incomingEdges)) {
+                const auto& incoming = incomingIt->second;
+
+                auto beginF = std::bind(beginPtr, &incoming);
+                auto endF = std::bind(endPtr, &incoming);
+
+                for (auto i = beginF(), e = endF(); i != e; ++i) {
+                    if (!dfsRecursive(visited, *i, beginPtr, endPtr, onBeforeNode, onAfterNode))
+                        return false;
+                }
+            }
+
+            if (onAfterNode && !onAfterNode(curNode))
+                return false;
+
+            return true;
+        }
+
+        std::unordered_map<node_t, nodes_t> incomingEdges;
+    };
+
+    /// @brief Chain of given length, each node derives previous one.
+    template<class DAGT>
+    node_t make_deep(DAGT& dag, node_t size) {
+        dag.add(0, nodes_t{});
+        for (node_t i = 1; i != size; ++i)
+            dag.add(i, nodes_t{i - 1});
+        return size - 1;
+    }
+
+    /// @brief Layers of given width, each node derives all nodes of
+    /// previous layer.
+    template<class DAGT>
+    node_t make_wide(DAGT& dag, node_t width) {
+        constexpr node_t layers = 4;
+        node_t root = 0;
+        dag.add(root, nodes_t{});
+
+        nodes_t previous{root};
+        node_t next = 1;
+        for (node_t l = 0; l != layers; ++l) {
+            nodes_t layer;
+            for (node_t i = 0; i != width; ++i) {
+                dag.add(next, previous);
+                layer.push_back(next++);
+            }
+            previous = std::move(layer);
+        }
+
+        dag.add(next, previous);
+        return next;
+    }
+
+    template<class DAGT>
+    void dag_walk(benchmark::State& state, node_t (*make)(DAGT&, node_t)) {
+        DAGT dag;
+        node_t start = make(dag, state.range(0));
+
+        for (auto _ : state) {
+            std::size_t visited = 0;
+            dag.dfs(start, nullptr, [&](node_t) { ++visited; return true; });
+            benchmark::DoNotOptimize(visited);
+        }
+    }
+
+    void dag_walk_deep(benchmark::State& state) {
+        dag_walk<DAG<node_t>>(state, &make_deep);
+    }
+
+    void dag_walk_recursiveDeep(benchmark::State& state) {
+        dag_walk<RecursiveDAG>(state, &make_deep);
+    }
+
+    void dag_walk_wide(benchmark::State& state) {
+        dag_walk<DAG<node_t>>(state, &make_wide);
+    }
+
+    void dag_walk_recursiveWide(benchmark::State& state) {
+        dag_walk<RecursiveDAG>(state, &make_wide);
+    }
+
+    /// @brief Asks whether deep chain end reaches each node of chain.
+    void dag_reaches(benchmark::State& state, bool indexed) {
+        DAG<node_t> dag;
+        node_t last = make_deep(dag, state.range(0));
+        if (indexed)
+            dag.buildReachability();
+
+        for (auto _ : state) {
+            std::size_t reached = 0;
+            for (node_t to = 0; to <= last; to += last / 16 + 1)
+                reached += dag.reaches(last, to);
+            benchmark::DoNotOptimize(reached);
+        }
+    }
+
+    void dag_reaches_walk(benchmark::State& state) {
+        dag_reaches(state, false);
+    }
+
+    void dag_reaches_index(benchmark::State& state) {
+        dag_reaches(state, true);
+    }
+}
+
+BENCHMARK(dag_walk_deep)->Arg(8)->Arg(30)->Arg(1000);
+BENCHMARK(dag_walk_recursiveDeep)->Arg(8)->Arg(30)->Arg(1000);
+BENCHMARK(dag_walk_wide)->Arg(2)->Arg(5)->Arg(50);
+BENCHMARK(dag_walk_recursiveWide)->Arg(2)->Arg(5)->Arg(50);
+BENCHMARK(dag_reaches_walk)->Arg(30)->Arg(1000);
+BENCHMARK(dag_reaches_index)->Arg(30)->Arg(1000);
@@ -0,0 +1,80 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Creation of objects by class name: ClassInfo::createInstance in
+// ObjectArena versus `new` behind string-keyed map of std::function.
+
+#include "details/benchmarks_common.h"
+
+#include <myrtti/hierarchy.h>
+#include <myrtti/object_arena.h>
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+with_rtti_root(struct, FactoryLeaf)
+    int value = 0;
+with_rtti_end();
+
+namespace {
+    /// @brief Classes by benchmark argument: shallow one, so allocation
+    /// cost is visible, and deep one, where construction dominates.
+    const std::string names[] = {"FactoryLeaf", "DeepFinal"};
+
+    std::unordered_map<std::string, std::function<Object*()>>& mapFactory() {
+        static std::unordered_map<std::string, std::function<Object*()>> factory{
+            {"FactoryLeaf", [] { return static_cast<Object*>(new FactoryLeaf); }},
+            {"DeepFinal", [] { return static_cast<Object*>(new DeepFinal); }},
+        };
+        return factory;
+    }
+}
+
+static void factory_arena(benchmark::State& state) {
+    auto* h = Hierarchy::instance();
+    ObjectArena arena;
+    std::vector<Object*> objects(state.range(1));
+    for (auto _ : state) {
+        const std::string& name = names[state.range(0)];
+        const ClassInfo* cls = h->getClassInfo(class_name_t(name));
+        for (auto& o : objects)
+            o = cls->createInstance(arena);
+        benchmark::DoNotOptimize(objects.data());
+        for (auto* o : objects)
+            arena.destroy(o);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+
+static void factory_map(benchmark::State& state) {
+    auto& factory = mapFactory();
+    std::vector<Object*> objects(state.range(1));
+    for (auto _ : state) {
+        const std::string& name = names[state.range(0)];
+        const auto& create = factory.at(name);
+        for (auto& o : objects)
+            o = create();
+        benchmark::DoNotOptimize(objects.data());
+        for (auto* o : objects)
+            delete o;
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+
+BENCHMARK(factory_arena)->ArgsProduct({{0, 1}, {1, 1000}});
+BENCHMARK(factory_map)->ArgsProduct({{0, 1}, {1, 1000}});
+BENCHMARK(factory_arena)->Args({0, 1000})->Threads(4);
+BENCHMARK(factory_map)->Args({0, 1000})->Threads(4);
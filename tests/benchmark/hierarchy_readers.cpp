@@ -0,0 +1,53 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Hierarchy read queries from many threads. Reads don't take locks, so
+// throughput should scale with amount of threads.
+
+#include "details/benchmarks_common.h"
+
+#include <myrtti/hierarchy.h>
+
+static void hierarchy_isParent(benchmark::State& state) {
+    auto* h = Hierarchy::instance();
+    auto child = DeepFinal::class_id();
+    auto parent = DeepRoot::class_id();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(h->isParent(child, parent));
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void hierarchy_getClassInfo(benchmark::State& state) {
+    auto* h = Hierarchy::instance();
+    auto cls = WideFinal::class_id();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(h->getClassInfo(cls));
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void hierarchy_unwind(benchmark::State& state) {
+    auto* h = Hierarchy::instance();
+    auto cls = WideFinal::class_id();
+    for (auto _ : state) {
+        h->unwind(cls, [](const ClassInfo* c) {
+            benchmark::DoNotOptimize(c);
+            return true;
+        });
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(hierarchy_isParent)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(hierarchy_getClassInfo)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(hierarchy_unwind)->ThreadRange(1, 8)->UseRealTime();
@@ -0,0 +1,230 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Registry of large synthetic hierarchy (100k classes defined at run
+// time): memory consumption and query costs.
+//
+// Each class derives random earlier class, some classes have 1-2 extra
+// parents, which gives wide hierarchy of moderate depth, similar to
+// generated code.
+
+#include "details/benchmarks_common.h"
+
+#include <myrtti/hierarchy.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+    std::size_t heap_used() {
+        #if defined(__GLIBC__)
+        auto mi = mallinfo2();
+        return mi.uordblks + mi.hblkhd;
+        #else
+        return 0;
+        #endif
+    }
+
+    struct Synthetic {
+        static constexpr std::size_t size = 100000;
+
+        std::vector<std::string> names;
+        std::vector<class_id_t> ids;
+        std::vector<class_id_t> parentIds;
+        std::vector<const ClassInfo*> parentClasses;
+        std::vector<std::unique_ptr<ClassInfo>> infos;
+
+        /// @brief Heap consumed by frozen registry, and by its tables.
+        double registryMB = 0;
+        double snapshotMB = 0;
+
+        /// @brief Time spent on registration of all classes.
+        double registerMs = 0;
+
+        Synthetic() {
+            std::mt19937_64 rnd(42);
+
+            std::vector<std::vector<std::size_t>> parents(size);
+            std::size_t totalParents = 0;
+            for (std::size_t i = 1; i != size; ++i) {
+                std::size_t extra = rnd() % 100 < 80 ? 0 : 1 + rnd() % 2;
+                for (std::size_t k = 0; k != 1 + extra; ++k) {
+                    std::size_t p = rnd() % i;
+                    if (std::find(begin(parents[i]), end(parents[i]), p) == end(parents[i]))
+                        parents[i].push_back(p);
+                }
+                totalParents += parents[i].size();
+            }
+
+            // Descriptions refer these arrays, so no reallocations allowed.
+            names.reserve(size);
+            ids.reserve(size);
+            parentIds.reserve(totalParents);
+            parentClasses.reserve(totalParents);
+            infos.reserve(size);
+
+            for (std::size_t i = 0; i != size; ++i) {
+                names.push_back("Synthetic" + std::to_string(i));
+                ids.emplace_back(names[i].c_str());
+            }
+
+            auto* h = Hierarchy::instance();
+            std::size_t heapBefore = heap_used();
+            auto started = std::chrono::steady_clock::now();
+
+            for (std::size_t i = 0; i != size; ++i) {
+                std::size_t first = parentIds.size();
+                for (std::size_t p : parents[i]) {
+                    parentIds.push_back(ids[p]);
+                    parentClasses.push_back(infos[p].get());
+                }
+                infos.push_back(std::make_unique<ClassInfo>(
+                    names[i].c_str(), ids[i],
+                    parentIds.data() + first, parentClasses.data() + first,
+                    parents[i].size()
+                ));
+                h->add(infos.back().get());
+            }
+
+            registerMs = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - started
+            ).count();
+            std::size_t heapRegistered = heap_used();
+
+            // Build tables, then release containers used for registration.
+            h->isParent(ids[0], ids[1]);
+            std::size_t heapPublished = heap_used();
+            h->freeze();
+            std::size_t heapFrozen = heap_used();
+
+            auto mb = [](std::size_t from, std::size_t to) {
+                return (double(to) - double(from)) / (1 << 20);
+            };
+            registryMB = mb(heapBefore, heapFrozen);
+            snapshotMB = mb(heapRegistered, heapPublished);
+        }
+    };
+
+    Synthetic& synthetic() {
+        static Synthetic s;
+        return s;
+    }
+
+    void reportMemory(benchmark::State& state) {
+        state.counters["registry_MB"] = synthetic().registryMB;
+        state.counters["snapshot_MB"] = synthetic().snapshotMB;
+        state.counters["register_ms"] = synthetic().registerMs;
+    }
+
+    /// @brief Small module of classes derived from synthetic ones.
+    struct Module {
+        static constexpr std::size_t size = 100;
+
+        std::vector<std::string> names;
+        std::vector<class_id_t> ids;
+        std::vector<class_id_t> parentIds;
+        std::vector<const ClassInfo*> parentClasses;
+        std::vector<std::unique_ptr<ClassInfo>> infos;
+
+        explicit Module(std::size_t seed) {
+            auto& s = synthetic();
+            std::mt19937_64 rnd(seed);
+
+            names.reserve(size);
+            ids.reserve(size);
+            parentIds.reserve(size);
+            parentClasses.reserve(size);
+            for (std::size_t i = 0; i != size; ++i) {
+                names.push_back("Module" + std::to_string(seed) + "_" + std::to_string(i));
+                ids.emplace_back(names[i].c_str());
+
+                std::size_t p = rnd() % s.size;
+                parentIds.push_back(s.ids[p]);
+                parentClasses.push_back(s.infos[p].get());
+
+                infos.push_back(std::make_unique<ClassInfo>(
+                    names[i].c_str(), ids[i], &parentIds[i], &parentClasses[i], 1
+                ));
+            }
+        }
+    };
+}
+
+static void largeHierarchy_isParent(benchmark::State& state) {
+    auto& s = synthetic();
+    auto* h = Hierarchy::instance();
+    std::mt19937_64 rnd(1);
+    for (auto _ : state) {
+        auto child = s.ids[rnd() % s.size];
+        auto parent = s.ids[rnd() % s.size];
+        benchmark::DoNotOptimize(h->isParent(child, parent));
+    }
+    reportMemory(state);
+}
+
+static void largeHierarchy_commonAncestors(benchmark::State& state) {
+    auto& s = synthetic();
+    auto* h = Hierarchy::instance();
+    std::mt19937_64 rnd(1);
+    for (auto _ : state) {
+        auto a = s.ids[rnd() % s.size];
+        auto b = s.ids[rnd() % s.size];
+        benchmark::DoNotOptimize(h->commonAncestors(a, b));
+    }
+    reportMemory(state);
+}
+
+static void largeHierarchy_descendants(benchmark::State& state) {
+    auto& s = synthetic();
+    auto* h = Hierarchy::instance();
+    std::mt19937_64 rnd(1);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(h->descendants(s.ids[rnd() % s.size]));
+    reportMemory(state);
+}
+
+// Module loaded into large hierarchy: registration of its classes and
+// first query, which merges them into registry tables.
+static void largeHierarchy_loadModule(benchmark::State& state) {
+    auto& s = synthetic();
+    auto* h = Hierarchy::instance();
+
+    // Modules are never unloaded, classes must stay alive.
+    static std::vector<std::unique_ptr<Module>> modules;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        modules.push_back(std::make_unique<Module>(modules.size()));
+        const Module& m = *modules.back();
+        state.ResumeTiming();
+
+        for (const auto& info : m.infos)
+            h->add(info.get());
+        benchmark::DoNotOptimize(h->isParent(m.ids[0], s.ids[0]));
+    }
+    reportMemory(state);
+}
+
+BENCHMARK(largeHierarchy_isParent);
+BENCHMARK(largeHierarchy_commonAncestors);
+BENCHMARK(largeHierarchy_descendants);
+BENCHMARK(largeHierarchy_loadModule)->Iterations(20)->Unit(benchmark::kMillisecond);
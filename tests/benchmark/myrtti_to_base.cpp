@@ -25,7 +25,7 @@
     void name() { \
         auto *ctx = BenchmarkContext::instance(); \
         auto *p = From; \
-        __myrtti_cast<To>(p); \
+        __myrtti_cast<To>(p, true); \
     } \
 
 DEFINE_TEST_CAST(deepToBase, DeepRoot, ctx->deep);
@@ -0,0 +1,96 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Definition of 10k classes at run time, each one resolved right after
+// it has been defined, while other threads keep casting objects and
+// querying hierarchy.
+
+#include "details/benchmarks_common.h"
+
+#include <myrtti/hierarchy.h>
+
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    constexpr std::size_t num_classes = 10000;
+
+    struct Readers {
+        explicit Readers(std::size_t n) {
+            for (std::size_t i = 0; i != n; ++i) {
+                threads.emplace_back([this] {
+                    auto* h = Hierarchy::instance();
+                    DeepFinal deep;
+                    Object* o = &deep;
+                    while (!stop.load(std::memory_order_relaxed)) {
+                        benchmark::DoNotOptimize(dyn_cast<DeepRoot*>(o));
+                        benchmark::DoNotOptimize(h->isParent(DeepFinal::class_id(), Deep10::class_id()));
+                    }
+                });
+            }
+        }
+
+        ~Readers() {
+            stop = true;
+            for (auto& t : threads)
+                t.join();
+        }
+
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> threads;
+    };
+}
+
+static void runtimeClasses_define(benchmark::State& state) {
+    auto* h = Hierarchy::instance();
+
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i != num_classes; ++i)
+        names.push_back("Scripted" + std::to_string(i));
+
+    Readers readers(state.range(0));
+
+    for (auto _ : state) {
+        std::mt19937 rnd(1);
+        Hierarchy::Module module;
+        {
+            Hierarchy::ModuleScope scope(module);
+
+            std::vector<const ClassInfo*> defined;
+            defined.reserve(num_classes);
+            for (std::size_t i = 0; i != num_classes; ++i) {
+                // Every 8th class has two parents.
+                const ClassInfo* parents[2] = {
+                    i ? defined[rnd() % i] : DeepFinal::info(),
+                    WideFinal::info()
+                };
+                defined.push_back(h->defineClass(names[i], {parents, i % 8 ? 1u : 2u}));
+                benchmark::DoNotOptimize(h->getClassInfo(defined.back()->getId()));
+            }
+        }
+
+        state.PauseTiming();
+        h->remove(module);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * num_classes);
+}
+
+BENCHMARK(runtimeClasses_define)
+    ->Arg(0)->Arg(2)
+    ->Unit(benchmark::kMillisecond)->UseRealTime()->Iterations(3);
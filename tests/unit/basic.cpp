@@ -14,7 +14,9 @@
 
 #include <gtest/gtest.h>
 #include <myrtti.h>
+#include <myrtti/hierarchy.h>
 
+#include <algorithm>
 #include <sstream>
 #include <string>
 
@@ -214,3 +216,60 @@ TEST(Basic, VirtualPrents) {
     EXPECT_STREQ(Destruct::out().str().c_str(), "ZXBAC");
     EXPECT_STREQ(unwindWalk.str().c_str(), "ZXBAC");
 }
+
+TEST(Basic, StaticRegistration) {
+
+    static_assert(
+        std::is_trivially_destructible_v<myrtti::ClassInfo>,
+        "ClassInfo should stay constant-initializable."
+    );
+
+    with_rtti_root(struct, TestRoot)
+    with_rtti_end();
+
+    with_rtti_root(struct, TestRoot2)
+    with_rtti_end();
+
+    with_rtti_parents(struct, Final, (TestRoot, TestRoot2))
+    with_rtti_end();
+
+    // Classes are linked during static initialization, neither
+    // instances nor info() calls are required.
+    auto *h = myrtti::Hierarchy::instance();
+    const myrtti::ClassInfo* finalInfo = h->getClassInfo(Final::class_id());
+
+    ASSERT_NE(finalInfo, nullptr);
+    EXPECT_TRUE(finalInfo->isRegistered());
+    EXPECT_EQ(finalInfo, Final::info());
+
+    auto parents = finalInfo->getParents();
+    ASSERT_EQ(parents.size(), 2u);
+    EXPECT_EQ(parents[0], TestRoot::class_id());
+    EXPECT_EQ(parents[1], TestRoot2::class_id());
+
+    EXPECT_TRUE(h->isParent(Final::class_id(), TestRoot2::class_id()));
+}
+
+#ifdef MYRTTI_CLASS_SECTION
+TEST(Basic, SectionRegistration) {
+    with_rtti_root(struct, SectionRoot)
+    with_rtti_end();
+
+    with_rtti(struct, SectionFinal, SectionRoot)
+    with_rtti_end();
+
+    // Classes are found in class section of executable, and registered
+    // by the first query.
+    auto entry = &myrtti::details::info_thunk<SectionFinal>;
+    EXPECT_NE(
+        std::find(__start_myrtti_classes, __stop_myrtti_classes, entry),
+        __stop_myrtti_classes
+    );
+
+    EXPECT_TRUE(myrtti::Hierarchy::instance()->isParent(
+        SectionFinal::class_id(), SectionRoot::class_id()
+    ));
+    EXPECT_TRUE(SectionRoot::info()->isRegistered());
+    EXPECT_TRUE(SectionFinal::info()->isRegistered());
+}
+#endif
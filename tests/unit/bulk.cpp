@@ -0,0 +1,245 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <myrtti.h>
+#include <myrtti/bulk.h>
+
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+
+TEST(Bulk, MakeMany) {
+
+    with_rtti_root(struct, Base)
+    with_rtti_end();
+
+    with_rtti(struct, A, Base)
+        int a = 1;
+    with_rtti_end();
+
+    with_rtti(struct, B, Base)
+        int b = 2;
+    with_rtti_end();
+
+    with_rtti_vparents_parents(struct, Final, (B), (A))
+        explicit Final(int v) : value(v) {}
+        int value;
+    with_rtti_end();
+
+    auto batch = myrtti::make_many<Final>(100, 42);
+    ASSERT_EQ(batch.size(), 100u);
+
+    Final reference(0);
+
+    for (Final& f : batch) {
+        myrtti::Object* o = &f;
+
+        EXPECT_EQ(f.value, 42);
+        EXPECT_EQ(o->rtti, Final::info());
+
+        EXPECT_EQ(myrtti::dyn_cast<Final*>(o), &f);
+        EXPECT_EQ(myrtti::dyn_cast<A*>(o), static_cast<A*>(&f));
+        EXPECT_EQ(myrtti::dyn_cast<B*>(o), static_cast<B*>(&f));
+        EXPECT_EQ(myrtti::dyn_cast<A*>(o)->a, 1);
+        EXPECT_EQ(myrtti::dyn_cast<B*>(o)->b, 2);
+
+        // Stamped objects look exactly like regularly constructed ones.
+        EXPECT_EQ(f.cast<Base*>() != nullptr, reference.cast<Base*>() != nullptr);
+    }
+
+    // Objects are placed contiguously.
+    EXPECT_EQ(&batch[99] - &batch[0], 99);
+
+    // Construction out of batch is not affected.
+    Final after(1);
+    EXPECT_EQ(myrtti::dyn_cast<A*>(static_cast<myrtti::Object*>(&after)),
+              static_cast<A*>(&after));
+}
+
+TEST(Bulk, ConstructorThrows) {
+
+    struct Counters {
+        static int& alive() {
+            static int v = 0;
+            return v;
+        }
+        static int& constructed() {
+            static int v = 0;
+            return v;
+        }
+    };
+
+    with_rtti_root(struct, Throwing)
+        Throwing() {
+            if (++Counters::constructed() == 5)
+                throw std::runtime_error("fifth");
+            ++Counters::alive();
+        }
+        ~Throwing() override { --Counters::alive(); }
+    with_rtti_end();
+
+    EXPECT_THROW(myrtti::make_many<Throwing>(10), std::runtime_error);
+    EXPECT_EQ(Counters::alive(), 0);
+
+    // Thread is out of stamp mode after exception.
+    Throwing t;
+    myrtti::Object* o = &t;
+    EXPECT_EQ(myrtti::dyn_cast<Throwing*>(o), &t);
+}
+
+TEST(Bulk, MemberObjects) {
+
+    with_rtti_root(struct, InnerBase)
+    with_rtti_end();
+
+    with_rtti(struct, Inner, InnerBase)
+    with_rtti_end();
+
+    with_rtti_root(struct, Outer)
+        Outer() {
+            // Objects created by constructor of stamped object are
+            // constructed as usual.
+            Inner temporary;
+            myrtti::Object* o = &temporary;
+            castInCtor = myrtti::dyn_cast<InnerBase*>(o) == static_cast<InnerBase*>(&temporary);
+        }
+
+        Inner in;
+        bool castInCtor = false;
+    with_rtti_end();
+
+    auto batch = myrtti::make_many<Outer>(3);
+    for (Outer& o : batch) {
+        myrtti::Object* in = &o.in;
+        EXPECT_EQ(myrtti::dyn_cast<Inner*>(in), &o.in);
+        EXPECT_EQ(myrtti::dyn_cast<InnerBase*>(in), static_cast<InnerBase*>(&o.in));
+        EXPECT_EQ(myrtti::dyn_cast<Outer*>(in), nullptr);
+        EXPECT_TRUE(o.castInCtor);
+
+        myrtti::Object* outer = &o;
+        EXPECT_EQ(myrtti::dyn_cast<Outer*>(outer), &o);
+        EXPECT_EQ(myrtti::dyn_cast<Inner*>(outer), nullptr);
+    }
+}
+
+TEST(Bulk, Allocator) {
+
+    with_rtti_root(struct, Pooled)
+        int value = 7;
+    with_rtti_end();
+
+    std::pmr::monotonic_buffer_resource arena;
+    std::pmr::polymorphic_allocator<Pooled> alloc(&arena);
+
+    auto first = myrtti::make_many<Pooled>(std::allocator_arg, alloc, 10);
+    auto second = myrtti::make_many<Pooled>(std::allocator_arg, alloc, 10);
+    ASSERT_EQ(first.size(), 10u);
+    ASSERT_EQ(second.size(), 10u);
+
+    for (Pooled& p : second) {
+        myrtti::Object* o = &p;
+        EXPECT_EQ(myrtti::dyn_cast<Pooled*>(o), &p);
+        EXPECT_EQ(p.value, 7);
+    }
+
+    EXPECT_EQ(&second[9] - &second[0], 9);
+
+    decltype(first) moved = std::move(first);
+    EXPECT_EQ(first.size(), 0u);
+    EXPECT_EQ(moved.size(), 10u);
+}
+
+TEST(Bulk, MoveOnlyArguments) {
+
+    with_rtti_root(struct, Holder)
+        explicit Holder(const std::unique_ptr<int>& v) : value(*v) {}
+        int value;
+    with_rtti_end();
+
+    // Argument is passed to each constructor as lvalue.
+    auto batch = myrtti::make_many<Holder>(3, std::make_unique<int>(5));
+    ASSERT_EQ(batch.size(), 3u);
+    for (Holder& h : batch)
+        EXPECT_EQ(h.value, 5);
+}
+
+TEST(Bulk, MoveAssignment) {
+
+    with_rtti_root(struct, Base)
+    with_rtti_end();
+
+    with_rtti(struct, Pooled, Base)
+        int value = 7;
+    with_rtti_end();
+
+    // Tracks bytes outstanding, so blocks are checked to be released
+    // through resource they have been obtained from.
+    struct TrackedResource : std::pmr::memory_resource {
+        std::ptrdiff_t outstanding = 0;
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+            outstanding += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+            outstanding -= bytes;
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+
+    // Allocator propagates: block is taken.
+    auto heap = myrtti::make_many<Pooled>(2);
+    auto heapSrc = myrtti::make_many<Pooled>(3);
+    Pooled* heapBlock = heapSrc.data();
+    heap = std::move(heapSrc);
+    EXPECT_EQ(heap.data(), heapBlock);
+    EXPECT_EQ(heap.size(), 3u);
+    EXPECT_EQ(heapSrc.size(), 0u);
+
+    TrackedResource first, second;
+    {
+        using alloc_t = std::pmr::polymorphic_allocator<Pooled>;
+
+        // Equal allocators: block is taken.
+        auto a = myrtti::make_many<Pooled>(std::allocator_arg, alloc_t(&first), 2);
+        auto b = myrtti::make_many<Pooled>(std::allocator_arg, alloc_t(&first), 4);
+        Pooled* block = b.data();
+        a = std::move(b);
+        EXPECT_EQ(a.data(), block);
+        EXPECT_EQ(b.size(), 0u);
+
+        // Different resources: objects are moved into block of target,
+        // cross pointers point to new objects.
+        auto c = myrtti::make_many<Pooled>(std::allocator_arg, alloc_t(&second), 5);
+        c[0].value = 8;
+        a = std::move(c);
+        ASSERT_EQ(a.size(), 5u);
+        EXPECT_EQ(c.size(), 0u);
+        EXPECT_EQ(a[0].value, 8);
+        EXPECT_EQ(second.outstanding, 0);
+
+        for (Pooled& p : a) {
+            myrtti::Object* o = &p;
+            EXPECT_EQ(myrtti::dyn_cast<Pooled*>(o), &p);
+            EXPECT_EQ(myrtti::dyn_cast<Base*>(o), static_cast<Base*>(&p));
+        }
+        EXPECT_GT(first.outstanding, 0);
+    }
+    EXPECT_EQ(first.outstanding, 0);
+    EXPECT_EQ(second.outstanding, 0);
+}
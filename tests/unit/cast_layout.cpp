@@ -0,0 +1,163 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <myrtti.h>
+#include <myrtti/cast_layout.h>
+#include <myrtti/cast_profile.h>
+#include <myrtti/hierarchy.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+TEST(CastLayout, ProfileRoundTrip) {
+
+    with_rtti_root(struct, TestRoot)
+    with_rtti_end();
+
+    with_rtti(struct, Final, TestRoot)
+    with_rtti_end();
+
+    myrtti::CastProfile profile;
+    for (int i = 0; i != 3; ++i)
+        profile.record(Final::info(), TestRoot::info());
+    profile.record(TestRoot::info(), Final::info());
+
+    std::ostringstream out;
+    profile.save(out);
+
+    myrtti::CastProfile loaded;
+    std::istringstream in(out.str());
+    loaded.load(in);
+    loaded.merge(profile);
+
+    auto entries = loaded.entries();
+    ASSERT_EQ(entries.size(), 2u);
+
+    EXPECT_EQ(entries[0].from, Final::class_id());
+    EXPECT_EQ(entries[0].to, TestRoot::class_id());
+    EXPECT_EQ(entries[0].count, 6u);
+    EXPECT_EQ(entries[0].fromName, "Final");
+    EXPECT_EQ(entries[0].toName, "TestRoot");
+
+    EXPECT_EQ(entries[1].from, TestRoot::class_id());
+    EXPECT_EQ(entries[1].count, 2u);
+
+    std::istringstream bad("1234 qwe\n");
+    EXPECT_THROW(loaded.load(bad), std::runtime_error);
+}
+
+TEST(CastLayout, BuildLayout) {
+
+    myrtti::CastProfile profile;
+
+    myrtti::class_id_t from{"From"};
+    for (uint64_t i = 0; i != 20; ++i) {
+        profile.add({
+            from, myrtti::class_id_t{"Target", i}, i + 1, "From", "Target"
+        });
+    }
+
+    auto layout = myrtti::CastLayout::build(profile);
+    ASSERT_EQ(layout->size(), 1u);
+
+    const myrtti::CastTable* table = layout->find(from);
+    ASSERT_NE(table, nullptr);
+    ASSERT_EQ(table->size(), 20u);
+
+    // Hottest targets go first.
+    EXPECT_EQ((*table)[0].target, (myrtti::class_id_t{"Target", uint64_t(19)}));
+    EXPECT_EQ((*table)[0].count, 20u);
+
+    // Each target resolves into its own entry.
+    for (uint64_t i = 0; i != 20; ++i) {
+        myrtti::class_id_t target{"Target", i};
+        const auto* entry = table->find(target);
+        ASSERT_NE(entry, nullptr);
+        EXPECT_EQ(entry->target, target);
+        EXPECT_EQ(entry->count, i + 1);
+    }
+    EXPECT_EQ(table->find(myrtti::class_id_t{"Unknown"}), nullptr);
+
+    // Layout survives save/load, seeds are preserved.
+    std::ostringstream out;
+    layout->save(out);
+    std::istringstream in(out.str());
+    auto loaded = myrtti::CastLayout::load(in);
+
+    const myrtti::CastTable* loadedTable = loaded->find(from);
+    ASSERT_NE(loadedTable, nullptr);
+    EXPECT_EQ(loadedTable->getSeed(), table->getSeed());
+    EXPECT_EQ(loadedTable->getBits(), table->getBits());
+    EXPECT_EQ(loadedTable->size(), table->size());
+
+    std::ostringstream header;
+    layout->emitHeader(header);
+    EXPECT_NE(header.str().find("setCastLayout"), std::string::npos);
+}
+
+TEST(CastLayout, MalformedBits) {
+    for (const char* bits : {"0", "9", "64", "4000000000"}) {
+        std::istringstream in(std::string("class 1 0 ") + bits + " 1\n    2 1\n");
+        EXPECT_THROW(myrtti::CastLayout::load(in), std::runtime_error) << bits;
+    }
+
+    EXPECT_THROW(
+        myrtti::CastTable(myrtti::class_id_t{"From"}, {}, {}, 0, 64),
+        std::runtime_error
+    );
+}
+
+TEST(CastLayout, LearnOffset) {
+    myrtti::CastTable table(
+        myrtti::class_id_t{"From"},
+        {myrtti::class_id_t{"To"}}, {1},
+        0, 1
+    );
+
+    const auto* entry = table.find(myrtti::class_id_t{"To"});
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->offset.load(), myrtti::CastTable::unknown_offset);
+
+    int vptr1, vptr2;
+    entry->learn(&vptr1, 16);
+    entry->learn(&vptr2, 32);
+
+    // Only the first dynamic type is remembered.
+    EXPECT_EQ(entry->vptr.load(), &vptr1);
+    EXPECT_EQ(entry->offset.load(), 16);
+}
+
+TEST(CastLayout, ApplyToHierarchy) {
+
+    with_rtti_root(struct, TestRoot)
+    with_rtti_end();
+
+    with_rtti(struct, Final, TestRoot)
+    with_rtti_end();
+
+    myrtti::CastProfile profile;
+    profile.record(Final::info(), TestRoot::info());
+
+    auto* h = myrtti::Hierarchy::instance();
+    h->setCastLayout(myrtti::CastLayout::build(profile));
+
+    ASSERT_NE(Final::info()->castTable.load(), nullptr);
+    EXPECT_EQ(Final::info()->castTable.load()->getId(), Final::class_id());
+    EXPECT_EQ(TestRoot::info()->castTable.load(), nullptr);
+
+    h->setCastLayout(nullptr);
+    EXPECT_EQ(Final::info()->castTable.load(), nullptr);
+}
@@ -0,0 +1,166 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Casts through cast tables, built against MYRTTI_CAST_LAYOUT library.
+
+#include <gtest/gtest.h>
+#include <myrtti.h>
+#include <myrtti/cast_layout.h>
+#include <myrtti/cast_profile.h>
+#include <myrtti/hierarchy.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+    with_rtti_root(struct, Root)
+        int root = 0;
+    with_rtti_end();
+
+    with_rtti(struct, Left, Root)
+        int left = 1;
+    with_rtti_end();
+
+    with_rtti(struct, Right, Root)
+        int right = 2;
+    with_rtti_end();
+
+    with_rtti_parents(struct, Final, (Left, Right))
+        int final = 3;
+    with_rtti_end();
+
+    with_rtti_root(struct, Unrelated)
+    with_rtti_end();
+
+    // Another dynamic type of Final class: it has its own vptr, and its
+    // Object subobject is placed differently.
+    struct Padding {
+        virtual ~Padding() = default;
+        char pad[40] = {};
+    };
+    struct Wider : Padding, Final {};
+
+    /// @brief Applies fresh layout with Final casts, so offsets are not
+    /// learned yet.
+    const myrtti::CastTable* apply_layout() {
+        // Tables are attached on registration, we check them before.
+        Final::info()->ensureRegistered();
+
+        myrtti::CastProfile profile;
+        profile.record(Final::info(), Left::info());
+        profile.record(Final::info(), Right::info());
+        profile.record(Final::info(), Unrelated::info());
+        myrtti::Hierarchy::instance()->setCastLayout(myrtti::CastLayout::build(profile));
+        return Final::info()->castTable.load();
+    }
+
+    myrtti::Object* as_object(Final& obj) { return &obj; }
+}
+
+TEST(CastLayoutCasts, LearnedOffset) {
+    const myrtti::CastTable* table = apply_layout();
+    ASSERT_NE(table, nullptr);
+    const auto* entry = table->find(Right::class_id());
+    ASSERT_NE(entry, nullptr);
+
+    Final a, b;
+    Right* expected = &a;
+
+    // The first cast takes crossPtrs and learns offset.
+    EXPECT_EQ(as_object(a)->cast<Right*>(), expected);
+    EXPECT_NE(entry->offset.load(), myrtti::CastTable::unknown_offset);
+    EXPECT_EQ(entry->vptr.load(), *reinterpret_cast<const void* const*>(as_object(a)));
+
+    // The next ones apply it, to any object of the same dynamic type.
+    EXPECT_EQ(as_object(a)->cast<Right*>(), expected);
+    EXPECT_EQ(&as_object(a)->cast<Right>(), expected);
+    EXPECT_EQ(as_object(b)->cast<Right*>(), static_cast<Right*>(&b));
+    EXPECT_EQ(as_object(b)->cast<Left*>(), static_cast<Left*>(&b));
+}
+
+TEST(CastLayoutCasts, OtherDynamicType) {
+    const myrtti::CastTable* table = apply_layout();
+    ASSERT_NE(table, nullptr);
+    const auto* entry = table->find(Left::class_id());
+    ASSERT_NE(entry, nullptr);
+
+    Final learned;
+    Wider other;
+    ASSERT_EQ(other.rtti, Final::info());
+    ASSERT_NE(
+        *reinterpret_cast<const void* const*>(as_object(other)),
+        *reinterpret_cast<const void* const*>(as_object(learned))
+    );
+
+    EXPECT_EQ(as_object(learned)->cast<Left*>(), static_cast<Left*>(&learned));
+    std::ptrdiff_t offset = entry->offset.load();
+
+    // Offset is not applicable to other vptr, crossPtrs are used, and
+    // learned pair stays as is.
+    for (int i = 0; i != 2; ++i)
+        EXPECT_EQ(as_object(other)->cast<Left*>(), static_cast<Left*>(&other));
+    EXPECT_EQ(entry->offset.load(), offset);
+    EXPECT_EQ(entry->vptr.load(), *reinterpret_cast<const void* const*>(as_object(learned)));
+}
+
+TEST(CastLayoutCasts, NotABase) {
+    const myrtti::CastTable* table = apply_layout();
+    ASSERT_NE(table, nullptr);
+    const auto* entry = table->find(Unrelated::class_id());
+    ASSERT_NE(entry, nullptr);
+
+    Final obj;
+    EXPECT_EQ(as_object(obj)->cast<Unrelated*>(), nullptr);
+    EXPECT_EQ(entry->offset.load(), myrtti::CastTable::not_a_base);
+
+    // Cached result.
+    EXPECT_EQ(as_object(obj)->cast<Unrelated*>(), nullptr);
+}
+
+TEST(CastLayoutCasts, SwapWhileCasting) {
+    apply_layout();
+
+    std::atomic<bool> done{false};
+    std::atomic<int> failures{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t != 4; ++t) {
+        threads.emplace_back([&] {
+            Final obj;
+            Wider other;
+            while (!done.load(std::memory_order_relaxed)) {
+                if (as_object(obj)->cast<Left*>() != static_cast<Left*>(&obj)
+                    || as_object(obj)->cast<Right*>() != static_cast<Right*>(&obj)
+                    || as_object(other)->cast<Right*>() != static_cast<Right*>(&other)
+                    || as_object(obj)->cast<Unrelated*>() != nullptr)
+                    failures.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    // Replaced layouts are released while other threads cast.
+    for (int i = 0; i != 200; ++i) {
+        if (i % 4 == 3)
+            myrtti::Hierarchy::instance()->setCastLayout(nullptr);
+        else
+            apply_layout();
+    }
+
+    done = true;
+    for (auto& t : threads)
+        t.join();
+    EXPECT_EQ(failures.load(), 0);
+
+    myrtti::Hierarchy::instance()->setCastLayout(nullptr);
+}
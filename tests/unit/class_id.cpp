@@ -17,6 +17,8 @@
 #include <crc/crc.hpp>
 #include <myrtti.h>
 #include <sstream>
+#include <string>
+#include <unordered_set>
 
 TEST(ClassId, Crc) {
 
@@ -47,12 +49,17 @@ TEST(ClassId, ClassId) {
     yy1 << y1;
     zz << z;
 
+    EXPECT_NE(x, y0);
+    EXPECT_NE(x, z);
+
+    if (!std::is_same_v<myrtti::class_id_hash, myrtti::id_hash::crc64>)
+        return;
+
     EXPECT_STREQ(xx.str().c_str(), "29aa-a28d-da3d-cec1");
     EXPECT_STREQ(yy0.str().c_str(), "54a1-2f75-8c0e-9996");
     EXPECT_STREQ(yy1.str().c_str(), "54a1-2f75-8c0e-9996");
     EXPECT_STREQ(zz.str().c_str(), "955b-6b44-099d-85b0");
 
-    EXPECT_NE(x, y0);
     EXPECT_EQ(y0, y1);
     EXPECT_NE(x, z);
     EXPECT_NE(y0, z);
@@ -62,3 +69,38 @@ TEST(ClassId, ClassId) {
     EXPECT_NE(x.value, z.value);
     EXPECT_NE(y0.value, z.value);
 }
+
+TEST(ClassId, HashPolicies) {
+    constexpr myrtti::id_hash::crc64 crc;
+    constexpr myrtti::id_hash::wyhash wy;
+
+    // Both policies are evaluated at compile time.
+    constexpr uint64_t crcId = crc("qwe", "file.cpp", 10);
+    constexpr uint64_t wyId = wy("qwe", "file.cpp", 10);
+
+    EXPECT_EQ(crcId, myrtti::CRC()("qwe", "file.cpp", 10));
+    EXPECT_NE(crcId, wyId);
+
+    EXPECT_EQ(wy("qwe", "file.cpp", 10), wyId);
+    EXPECT_NE(wy("qwe", "file.cpp", 11), wyId);
+    EXPECT_NE(wy("qwf", "file.cpp", 10), wyId);
+    EXPECT_NE(wy("qwe", "file.cpq", 10), wyId);
+
+    // Arguments boundaries matter for wyhash.
+    EXPECT_NE(wy("qweqwe"), wy("qwe", "qwe"));
+
+    // Names of all lengths around word and block boundaries, which
+    // differ in single byte only, get different ids.
+    std::unordered_set<uint64_t> ids;
+    std::string name;
+    for (int len = 1; len <= 40; ++len) {
+        name.assign(len, 'a');
+        for (int pos = 0; pos != len; ++pos) {
+            name[pos] = 'b';
+            ids.insert(wy(name.c_str()));
+            ids.insert(wy(name.c_str(), "file.cpp", len));
+            name[pos] = 'a';
+        }
+    }
+    EXPECT_EQ(ids.size(), std::size_t(2 * 40 * 41 / 2));
+}
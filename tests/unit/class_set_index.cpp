@@ -0,0 +1,167 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+#include <myrtti.h>
+#include <myrtti/class_set_index.h>
+#include <myrtti/hierarchy.h>
+#include <myrtti/visitor.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using myrtti::ClassSetIndex;
+
+TEST(ClassSetIndex, Nearest) {
+
+    with_rtti_root(struct, SetRoot)
+    with_rtti_end();
+
+    with_rtti(struct, SetA, SetRoot)
+    with_rtti_end();
+
+    with_rtti(struct, SetB, SetA)
+    with_rtti_end();
+
+    with_rtti(struct, SetC, SetRoot)
+    with_rtti_end();
+
+    with_rtti_vparents_parents(struct, SetFinal, (SetC), (SetB))
+    with_rtti_end();
+
+    ClassSetIndex index{SetRoot::class_id(), SetA::class_id()};
+
+    // Twice, for the second lookup is answered by memo.
+    for (int i = 0; i != 2; ++i) {
+        EXPECT_EQ(index.find(SetRoot::info()), 0u);
+        EXPECT_EQ(index.find(SetA::info()), 1u);
+        EXPECT_EQ(index.find(SetB::info()), 1u);
+        EXPECT_EQ(index.find(SetC::info()), 0u);
+    }
+
+    EXPECT_EQ(index.position(SetA::class_id()), 1u);
+    EXPECT_EQ(index.position(SetB::class_id()), ClassSetIndex::npos);
+
+    ClassSetIndex leaves{SetC::class_id(), SetB::class_id(), SetC::class_id()};
+    EXPECT_EQ(leaves.find(SetRoot::info()), ClassSetIndex::npos);
+    EXPECT_EQ(leaves.find(SetA::info()), ClassSetIndex::npos);
+    EXPECT_EQ(leaves.find(SetC::info()), 0u);
+
+    // Nearest member is the first one in unwind order.
+    for (const myrtti::ClassInfo* cls : myrtti::unwind_order(SetFinal::info())) {
+        auto pos = leaves.position(cls->getId());
+        if (pos != ClassSetIndex::npos) {
+            EXPECT_EQ(leaves.find(SetFinal::info()), pos);
+            break;
+        }
+    }
+}
+
+TEST(ClassSetIndex, ClassesRegisteredLater) {
+
+    with_rtti_root(struct, LaterBase)
+    with_rtti_end();
+
+    auto* h = myrtti::Hierarchy::instance();
+
+    // Member itself is registered after index is built.
+    myrtti::class_id_t memberId("LaterMember");
+    ClassSetIndex index{LaterBase::class_id(), memberId};
+
+    EXPECT_EQ(index.find(LaterBase::info()), 0u);
+
+    // Classes stay registered, so they don't leave holes in registry
+    // (see Hierarchy.Image test), hence static storage.
+    static const myrtti::class_id_t memberParents[] = {LaterBase::class_id()};
+    static const myrtti::ClassInfo* memberParentClasses[] = {LaterBase::info()};
+    static myrtti::ClassInfo member("LaterMember", memberId, memberParents, memberParentClasses, 1);
+
+    h->add(&member);
+    EXPECT_EQ(index.find(&member), 1u);
+
+    // Enough classes to make memo grow several times. Every odd one
+    // derives from member.
+    static const myrtti::class_id_t laterParents[] = {LaterBase::class_id(), memberId};
+    constexpr std::size_t n = 300;
+    static std::vector<std::string> names;
+    static std::vector<myrtti::class_id_t> ids;
+    static std::vector<const myrtti::ClassInfo*> parents;
+    static std::vector<std::unique_ptr<myrtti::ClassInfo>> infos;
+    names.reserve(n);
+    ids.reserve(n);
+    parents.reserve(n);
+
+    for (std::size_t i = 0; i != n; ++i) {
+        names.push_back("Later" + std::to_string(i));
+        ids.emplace_back(names[i].c_str());
+        parents.push_back(i % 2 ? &member : LaterBase::info());
+        infos.push_back(std::make_unique<myrtti::ClassInfo>(
+            names[i].c_str(), ids[i],
+            laterParents + i % 2, &parents[i], 1
+        ));
+    }
+
+    for (std::size_t i = 0; i != n; ++i) {
+        h->add(infos[i].get());
+        EXPECT_EQ(index.find(infos[i].get()), i % 2 ? 1u : 0u) << names[i];
+    }
+
+    // Previously memoized answers survive growth.
+    EXPECT_EQ(index.find(LaterBase::info()), 0u);
+    EXPECT_EQ(index.find(&member), 1u);
+}
+
+TEST(ClassSetIndex, Visitor) {
+
+    with_rtti_root(struct, VisitedRoot)
+    with_rtti_end();
+
+    with_rtti(struct, VisitedA, VisitedRoot)
+    with_rtti_end();
+
+    with_rtti(struct, VisitedB, VisitedA)
+    with_rtti_end();
+
+    std::vector<std::string> calls;
+
+    myrtti::Visitor visitor(
+        [&](const VisitedRoot&) {
+            calls.push_back("Root");
+            return true;
+        },
+        [&](const VisitedA&) {
+            calls.push_back("A");
+            // Refuses, so visit goes on with parent handler.
+            return false;
+        }
+    );
+
+    EXPECT_TRUE(visitor.visit(VisitedB()));
+    EXPECT_EQ(calls, (std::vector<std::string>{"A", "Root"}));
+
+    calls.clear();
+    EXPECT_TRUE(visitor.visit(VisitedRoot()));
+    EXPECT_EQ(calls, std::vector<std::string>{"Root"});
+
+    myrtti::VisitorStatic staticVisitor({
+        {VisitedA::class_id(), [&] { calls.push_back("StaticA"); return true; }}
+    });
+
+    calls.clear();
+    EXPECT_TRUE(staticVisitor.visit<VisitedB>());
+    EXPECT_FALSE(staticVisitor.visit<VisitedRoot>());
+    EXPECT_EQ(calls, std::vector<std::string>{"StaticA"});
+}
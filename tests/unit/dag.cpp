@@ -0,0 +1,224 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <myrtti/dag.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace {
+    using dag_t = myrtti::DAG<uint32_t>;
+    using nodes_t = std::vector<uint32_t>;
+}
+
+TEST(DAG, Walk) {
+
+    // Diamond 0 <- {1, 2} <- 3, and 2 <- 4, both 3 and 4 are parents of 5.
+    dag_t dag;
+    dag.add(0u, nodes_t{});
+    dag.add(1u, nodes_t{0});
+    dag.add(2u, nodes_t{0});
+    dag.add(3u, nodes_t{1, 2});
+    dag.add(4u, nodes_t{2});
+    dag.add(5u, nodes_t{3, 4});
+
+    nodes_t before, after;
+    EXPECT_TRUE(dag.dfs(
+        5u,
+        [&](uint32_t n) { before.push_back(n); return true; },
+        [&](uint32_t n) { after.push_back(n); return true; }
+    ));
+    EXPECT_EQ(before, (nodes_t{5, 3, 1, 0, 2, 4}));
+    EXPECT_EQ(after, (nodes_t{0, 1, 2, 3, 4, 5}));
+
+    // Reversive side walk.
+    before.clear();
+    EXPECT_TRUE(dag.dfs(5u, [&](uint32_t n) { before.push_back(n); return true; }, nullptr, true));
+    EXPECT_EQ(before, (nodes_t{5, 4, 2, 0, 3, 1}));
+
+    // Empty std::function callbacks are skipped.
+    after.clear();
+    dag_t::node_callback_t none;
+    EXPECT_TRUE(dag.dfs(3u, none, [&](uint32_t n) { after.push_back(n); return true; }));
+    EXPECT_EQ(after, (nodes_t{0, 1, 2, 3}));
+
+    // Level by level.
+    before.clear();
+    EXPECT_TRUE(dag.bfs(5u, [&](uint32_t n) { before.push_back(n); return true; }));
+    EXPECT_EQ(before, (nodes_t{5, 3, 4, 1, 2, 0}));
+
+    // Walks started by callbacks have visited marks of their own.
+    after.clear();
+    EXPECT_TRUE(dag.dfs(4u, [&](uint32_t n) {
+        nodes_t nested;
+        dag.dfs(3u, [&](uint32_t m) { nested.push_back(m); return true; });
+        EXPECT_EQ(nested, (nodes_t{3, 1, 0, 2}));
+        after.push_back(n);
+        return true;
+    }));
+    EXPECT_EQ(after, (nodes_t{4, 2, 0}));
+
+    // Unknown node has no predecessors.
+    before.clear();
+    EXPECT_TRUE(dag.dfs(42u, [&](uint32_t n) { before.push_back(n); return true; }));
+    EXPECT_EQ(before, (nodes_t{42}));
+
+    // Interrupted walk.
+    before.clear();
+    EXPECT_FALSE(dag.dfs(5u, [&](uint32_t n) { before.push_back(n); return n != 0; }));
+    EXPECT_EQ(before, (nodes_t{5, 3, 1, 0}));
+}
+
+TEST(DAG, Remove) {
+
+    dag_t dag;
+    dag.add(0u, nodes_t{});
+    dag.add(1u, nodes_t{0});
+    dag.add(2u, nodes_t{1});
+
+    // Parents might be added after their children.
+    dag.add(4u, nodes_t{3});
+    dag.add(3u, nodes_t{0});
+
+    EXPECT_TRUE(dag.remove(2u));
+    EXPECT_FALSE(dag.remove(2u));
+    EXPECT_FALSE(dag.add(1u, nodes_t{}));
+
+    // Index of removed node is reused.
+    dag.add(5u, nodes_t{1, 4});
+
+    nodes_t after;
+    EXPECT_TRUE(dag.dfs(5u, nullptr, [&](uint32_t n) { after.push_back(n); return true; }));
+    EXPECT_EQ(after, (nodes_t{0, 1, 3, 4, 5}));
+}
+
+TEST(DAG, DeepWalk) {
+
+    // Chain is much deeper than call stack would allow for recursive walk
+    // in debug builds, and walk visits more nodes than are kept inline.
+    constexpr uint32_t depth = 200000;
+
+    dag_t dag;
+    dag.add(0u, nodes_t{});
+    for (uint32_t i = 1; i != depth; ++i)
+        dag.add(i, nodes_t{i - 1});
+
+    uint32_t visited = 0;
+    uint32_t expected = 0;
+    bool ordered = true;
+    EXPECT_TRUE(dag.dfs(depth - 1, nullptr, [&](uint32_t n) {
+        ++visited;
+        ordered = ordered && n == expected++;
+        return true;
+    }));
+    EXPECT_EQ(visited, depth);
+    EXPECT_TRUE(ordered);
+}
+
+TEST(DAG, Reachability) {
+
+    // Node i has up to 3 parents among 64 previous nodes, nodes in
+    // [0, 1000) which are multiples of 100 are roots. Layered graph has
+    // 4 layers of 5000 nodes instead, with parents in previous layer, so
+    // its levels are big enough to be labeled in parallel.
+    auto build = [](uint32_t size, bool layered) {
+        dag_t dag;
+        uint32_t seed = 12345;
+        auto next = [&] { return seed = seed * 1103515245 + 12345, seed >> 8; };
+
+        for (uint32_t i = 0; i != size; ++i) {
+            nodes_t parents;
+            if (layered) {
+                for (uint32_t k = 0, n = next() % 3 + 1; k != n && i >= 5000; ++k)
+                    parents.push_back((i / 5000 - 1) * 5000 + next() % 5000);
+            } else if (i % 100 || i >= 1000) {
+                for (uint32_t k = 0, n = next() % 3 + 1; k != n && i; ++k)
+                    parents.push_back(i - 1 - next() % std::min(i, 64u));
+            }
+            dag.add(i, parents);
+        }
+        return dag;
+    };
+
+    for (auto [threads, layered] : {std::pair{1u, false}, {4u, false}, {1u, true}, {4u, true}}) {
+        dag_t dag = build(20000, layered);
+
+        std::vector<std::pair<uint32_t, uint32_t>> queries;
+        uint32_t seed = 777;
+        for (int q = 0; q != 2000; ++q) {
+            seed = seed * 1103515245 + 12345;
+            uint32_t from = (seed >> 8) % 20000;
+            seed = seed * 1103515245 + 12345;
+            uint32_t to = from - std::min(from, (seed >> 8) % (layered ? 12000 : 300));
+            queries.emplace_back(from, to);
+        }
+
+        std::vector<bool> walked;
+        for (auto [from, to] : queries)
+            walked.push_back(dag.reaches(from, to));
+
+        dag.buildReachability(threads);
+        for (std::size_t q = 0; q != queries.size(); ++q) {
+            auto [from, to] = queries[q];
+            EXPECT_EQ(dag.reaches(from, to), walked[q]) << from << " -> " << to;
+        }
+    }
+}
+
+TEST(DAG, ReachabilityBitset) {
+
+    // Each node of layer is parent of each node of next layer, so nodes
+    // are reached by many scattered ones and get bitset labels.
+    constexpr uint32_t layers = 8, width = 16;
+    dag_t dag;
+    for (uint32_t l = 0; l != layers; ++l) {
+        for (uint32_t i = 0; i != width; ++i) {
+            nodes_t parents;
+            for (uint32_t p = 0; l && p != width; ++p)
+                parents.push_back((l - 1) * width + p);
+            dag.add(l * width + i, parents);
+        }
+    }
+
+    dag.buildReachability(2);
+    for (uint32_t from = 0; from != layers * width; ++from) {
+        for (uint32_t to = 0; to != layers * width; ++to) {
+            bool expected = from == to || to / width < from / width;
+            EXPECT_EQ(dag.reaches(from, to), expected) << from << " -> " << to;
+        }
+    }
+}
+
+TEST(DAG, ReachabilityUpdate) {
+    dag_t dag;
+    dag.add(0u, nodes_t{});
+    dag.add(1u, nodes_t{0});
+    dag.buildReachability();
+
+    EXPECT_TRUE(dag.reaches(1u, 0u));
+    EXPECT_FALSE(dag.reaches(0u, 1u));
+    EXPECT_TRUE(dag.reaches(7u, 7u));
+    EXPECT_FALSE(dag.reaches(7u, 0u));
+
+    // Index is dropped, new nodes are answered by walk.
+    dag.add(2u, nodes_t{1});
+    EXPECT_TRUE(dag.reaches(2u, 0u));
+
+    dag.buildReachability();
+    EXPECT_TRUE(dag.reaches(2u, 0u));
+    EXPECT_FALSE(dag.reaches(0u, 2u));
+}
@@ -0,0 +1,873 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+#include <myrtti.h>
+#include <myrtti/dag.h>
+#include <myrtti/hierarchy.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+    // Chain of classes defined at run time, each class derives previous one.
+    // Parent getters should be plain functions, hence static storage.
+
+    constexpr std::size_t chain_size = 64;
+
+    std::array<std::string, chain_size> chainNames;
+    std::vector<myrtti::class_id_t> chainIds;
+    std::array<std::unique_ptr<myrtti::ClassInfo>, chain_size> chainInfos;
+
+    template<std::size_t I>
+    const myrtti::ClassInfo* chainInfo() { return chainInfos[I].get(); }
+
+    template<std::size_t ...I>
+    constexpr std::array<myrtti::ClassInfo::info_getter_t, sizeof...(I)>
+    makeChainGetters(std::index_sequence<I...>) { return {&chainInfo<I>...}; }
+
+    constexpr auto chainGetters = makeChainGetters(std::make_index_sequence<chain_size>());
+
+    void makeChain() {
+        // Parents are referenced by pointer, so no reallocations allowed.
+        chainIds.reserve(chain_size);
+        for (std::size_t i = 0; i != chain_size; ++i) {
+            chainNames[i] = "ConcurrentChain" + std::to_string(i);
+            chainIds.emplace_back(chainNames[i].c_str(), uint64_t(i));
+            if (i == 0)
+                chainInfos[i] = std::make_unique<myrtti::ClassInfo>(
+                    chainNames[i].c_str(), chainIds[i]
+                );
+            else
+                chainInfos[i] = std::make_unique<myrtti::ClassInfo>(
+                    chainNames[i].c_str(), chainIds[i],
+                    &chainIds[i - 1], &chainGetters[i - 1], 1
+                );
+        }
+    }
+}
+
+TEST(Hierarchy, ConcurrentReaders) {
+
+    with_rtti_root(struct, Base)
+    with_rtti_end();
+
+    with_rtti(struct, Final, Base)
+    with_rtti_end();
+
+    makeChain();
+
+    auto* h = myrtti::Hierarchy::instance();
+    h->add(Final::info());
+
+    auto windupSize = [&](myrtti::class_id_t cls) {
+        std::size_t n = 0;
+        h->windup(cls, [&](const myrtti::ClassInfo*) {
+            ++n;
+            return true;
+        });
+        return n;
+    };
+    const std::size_t finalWindupSize = windupSize(Final::class_id());
+
+    std::atomic<bool> done{false};
+    std::atomic<std::size_t> failures{0};
+
+    auto reader = [&] {
+        while (!done.load(std::memory_order_relaxed)) {
+            if (!h->isParent(Final::class_id(), Base::class_id()))
+                ++failures;
+            if (h->getClassInfo(Final::class_id()) != Final::info())
+                ++failures;
+
+            if (windupSize(Final::class_id()) != finalWindupSize)
+                ++failures;
+
+            // Chain grows concurrently, whatever is visible should be
+            // consistent.
+            for (std::size_t i = 1; i != chain_size; ++i) {
+                if (!h->getClassInfo(chainIds[i]))
+                    break;
+                if (!h->isParent(chainIds[i], chainIds[0]))
+                    ++failures;
+            }
+        }
+    };
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i != 4; ++i)
+        readers.emplace_back(reader);
+
+    for (const auto& info : chainInfos) {
+        h->add(info.get());
+        std::this_thread::yield();
+    }
+
+    done = true;
+    for (auto& t : readers)
+        t.join();
+
+    EXPECT_EQ(failures.load(), 0u);
+
+    for (std::size_t i = 0; i != chain_size; ++i) {
+        EXPECT_TRUE(chainInfos[i]->isRegistered());
+        EXPECT_EQ(h->getClassInfo(chainIds[i]), chainInfos[i].get());
+    }
+
+    std::vector<const myrtti::ClassInfo*> unwound;
+    h->unwind(chainIds[chain_size - 1], [&](const myrtti::ClassInfo* cls) {
+        unwound.push_back(cls);
+        return true;
+    });
+    ASSERT_EQ(unwound.size(), chain_size);
+    EXPECT_EQ(unwound.front(), chainInfos[chain_size - 1].get());
+    EXPECT_EQ(unwound.back(), chainInfos[0].get());
+}
+
+namespace {
+    const myrtti::ClassInfo* lateRootInfo();
+
+    constexpr myrtti::class_id_t lateRootId{"LateRoot"};
+    constexpr myrtti::class_id_t lateChildId{"LateChild"};
+
+    constexpr myrtti::class_id_t lateChildParents[] = {lateRootId};
+    constexpr myrtti::ClassInfo::info_getter_t lateChildParentInfos[] = {&lateRootInfo};
+
+    const myrtti::ClassInfo lateRoot("LateRoot", lateRootId);
+    const myrtti::ClassInfo lateChild(
+        "LateChild", lateChildId, lateChildParents, lateChildParentInfos, 1
+    );
+
+    const myrtti::ClassInfo* lateRootInfo() { return &lateRoot; }
+}
+
+TEST(Hierarchy, Freeze) {
+
+    with_rtti_root(struct, Base)
+    with_rtti_end();
+
+    with_rtti(struct, Final, Base)
+    with_rtti_end();
+
+    auto* h = myrtti::Hierarchy::instance();
+
+    h->freeze();
+    EXPECT_TRUE(h->isFrozen());
+
+    EXPECT_TRUE(h->isParent(Final::class_id(), Base::class_id()));
+    EXPECT_FALSE(h->isParent(Base::class_id(), Final::class_id()));
+    EXPECT_EQ(h->getClassInfo(Final::class_id()), Final::info());
+    EXPECT_EQ(h->getClassInfo(lateChildId), nullptr);
+
+    std::vector<const myrtti::ClassInfo*> woundUp;
+    h->windup(Final::class_id(), [&](const myrtti::ClassInfo* cls) {
+        woundUp.push_back(cls);
+        return true;
+    });
+    ASSERT_GE(woundUp.size(), 2u);
+    EXPECT_EQ(woundUp.back(), Final::info());
+    EXPECT_EQ(woundUp[woundUp.size() - 2], Base::info());
+
+    // Adding classes after freeze is still possible.
+    h->add(&lateChild);
+    EXPECT_FALSE(h->isFrozen());
+
+    // Automatic freeze happens on first query.
+    h->setAutoFreeze(true);
+    EXPECT_FALSE(h->isFrozen());
+    EXPECT_TRUE(lateRoot.isRegistered());
+    EXPECT_LT(lateRoot.getIndex(), lateChild.getIndex());
+    EXPECT_TRUE(h->isParent(lateChildId, lateRootId));
+    EXPECT_EQ(h->getClassInfo(lateChildId), &lateChild);
+    EXPECT_TRUE(h->isFrozen());
+    h->setAutoFreeze(false);
+}
+
+TEST(Hierarchy, Linearization) {
+
+    with_rtti_root(struct, Base)
+    with_rtti_end();
+
+    with_rtti_vparents(struct, A, (Base))
+    with_rtti_end();
+
+    with_rtti_vparents(struct, B, (Base))
+    with_rtti_end();
+
+    with_rtti_vparents(struct, C, (A, B))
+    with_rtti_end();
+
+    with_rtti_vparents(struct, D, (B, A))
+    with_rtti_end();
+
+    with_rtti_vparents(struct, E, (C, D, B))
+    with_rtti_end();
+
+    // Reference: deep first walks on plain DAG.
+    myrtti::DAG<myrtti::class_id_t> dag;
+    std::unordered_map<myrtti::class_id_t, const myrtti::ClassInfo*> infos;
+    for (auto* cls : {
+        myrtti::Object::info(), Base::info(),
+        A::info(), B::info(), C::info(), D::info(), E::info()
+    }) {
+        dag.add(cls->getId(), cls->getParents());
+        infos.emplace(cls->getId(), cls);
+    }
+
+    for (auto* cls : {A::info(), C::info(), D::info(), E::info()}) {
+        std::vector<const myrtti::ClassInfo*> windup, unwind;
+        dag.dfs(cls->getId(), nullptr, [&](myrtti::class_id_t id) {
+            windup.push_back(infos[id]);
+            return true;
+        });
+        dag.dfs(cls->getId(), [&](myrtti::class_id_t id) {
+            unwind.push_back(infos[id]);
+            return true;
+        }, nullptr, true);
+
+        auto windupOrder = myrtti::windup_order(cls);
+        auto unwindOrder = myrtti::unwind_order(cls);
+
+        EXPECT_EQ(
+            std::vector<const myrtti::ClassInfo*>(begin(windupOrder), end(windupOrder)),
+            windup
+        ) << cls->name;
+        EXPECT_EQ(
+            std::vector<const myrtti::ClassInfo*>(begin(unwindOrder), end(unwindOrder)),
+            unwind
+        ) << cls->name;
+    }
+
+    EXPECT_EQ(myrtti::windup_order(E::info()).size(), 7u);
+    EXPECT_EQ(myrtti::unwind_order(E::info())[0], E::info());
+}
+
+TEST(Hierarchy, Descendants) {
+
+    //      Base
+    //     /    \
+    //    A      B
+    //    | \  / |
+    //    |  C   |
+    //     \ |  /
+    //       D
+
+    with_rtti_root(struct, Base)
+    with_rtti_end();
+
+    with_rtti_vparents(struct, A, (Base))
+    with_rtti_end();
+
+    with_rtti_vparents(struct, B, (Base))
+    with_rtti_end();
+
+    with_rtti_vparents(struct, C, (A, B))
+    with_rtti_end();
+
+    with_rtti_vparents(struct, D, (A, C, B))
+    with_rtti_end();
+
+    auto* h = myrtti::Hierarchy::instance();
+
+    auto toVector = [](myrtti::span<const myrtti::ClassInfo* const> s) {
+        return std::vector<const myrtti::ClassInfo*>(begin(s), end(s));
+    };
+
+    auto all = toVector(h->descendants(Base::class_id()));
+    ASSERT_EQ(all.size(), 4u);
+
+    // Topological order.
+    auto pos = [&](const myrtti::ClassInfo* cls) {
+        return std::find(begin(all), end(all), cls) - begin(all);
+    };
+    EXPECT_LT(pos(A::info()), pos(C::info()));
+    EXPECT_LT(pos(B::info()), pos(C::info()));
+    EXPECT_LT(pos(C::info()), pos(D::info()));
+
+    // By depth: direct children go first.
+    auto byDepth = toVector(h->descendants(Base::class_id(), true));
+    ASSERT_EQ(byDepth.size(), 4u);
+    std::sort(begin(byDepth), begin(byDepth) + 2);
+    std::vector<const myrtti::ClassInfo*> expectedChildren{A::info(), B::info()};
+    std::sort(begin(expectedChildren), end(expectedChildren));
+    EXPECT_TRUE(std::equal(begin(expectedChildren), end(expectedChildren), begin(byDepth)));
+
+    // Both C and D derive A directly.
+    auto fromA = toVector(h->descendants(A::class_id(), true));
+    ASSERT_EQ(fromA.size(), 2u);
+
+    auto fromC = toVector(h->descendants(C::class_id()));
+    ASSERT_EQ(fromC.size(), 1u);
+    EXPECT_EQ(fromC[0], D::info());
+
+    EXPECT_TRUE(h->descendants(D::class_id()).empty());
+    EXPECT_TRUE(h->descendants(myrtti::class_id_t{"NotRegistered"}).empty());
+
+    // Object is root of everything.
+    EXPECT_GE(h->descendants(myrtti::Object::class_id()).size(), 5u);
+
+    // Lists are maintained by registration, so repeated queries return
+    // the same range, and class registered later takes its place by
+    // depth, before deeper classes registered earlier.
+    EXPECT_EQ(h->descendants(Base::class_id(), true).data(), h->descendants(Base::class_id(), true).data());
+
+    const myrtti::ClassInfo* lateParents[] = {Base::info()};
+    const myrtti::ClassInfo* late = h->defineClass("DescendantsLate", {lateParents, 1});
+
+    auto lateAll = toVector(h->descendants(Base::class_id()));
+    ASSERT_EQ(lateAll.size(), 5u);
+    EXPECT_EQ(lateAll.back(), late);
+
+    auto lateByDepth = toVector(h->descendants(Base::class_id(), true));
+    ASSERT_EQ(lateByDepth.size(), 5u);
+    EXPECT_EQ(lateByDepth[2], late);
+    EXPECT_TRUE(std::is_permutation(begin(expectedChildren), end(expectedChildren), begin(lateByDepth)));
+}
+
+TEST(Hierarchy, CommonAncestors) {
+
+    with_rtti_root(struct, Base)
+    with_rtti_end();
+
+    with_rtti_root(struct, Unrelated)
+    with_rtti_end();
+
+    with_rtti_vparents(struct, A, (Base))
+    with_rtti_end();
+
+    with_rtti_vparents(struct, B, (Base))
+    with_rtti_end();
+
+    with_rtti_vparents(struct, C, (A, B))
+    with_rtti_end();
+
+    with_rtti_vparents(struct, D, (B, A))
+    with_rtti_end();
+
+    auto* h = myrtti::Hierarchy::instance();
+
+    using infos_t = std::vector<const myrtti::ClassInfo*>;
+    auto sorted = [](infos_t v) {
+        std::sort(begin(v), end(v));
+        return v;
+    };
+
+    EXPECT_EQ(
+        sorted(h->commonAncestors(C::class_id(), D::class_id())),
+        sorted({A::info(), B::info()})
+    );
+    EXPECT_EQ(h->commonAncestors(C::class_id(), A::class_id()), infos_t{A::info()});
+    EXPECT_EQ(h->commonAncestors(C::class_id(), C::class_id()), infos_t{C::info()});
+    EXPECT_EQ(h->commonAncestors(A::class_id(), B::class_id()), infos_t{Base::info()});
+    EXPECT_EQ(
+        h->commonAncestors(C::class_id(), Unrelated::class_id()),
+        infos_t{myrtti::Object::info()}
+    );
+    EXPECT_TRUE(h->commonAncestors(C::class_id(), myrtti::class_id_t{"NotRegistered"}).empty());
+
+    myrtti::class_id_t ids[] = {C::class_id(), D::class_id(), A::class_id()};
+    EXPECT_EQ(h->commonAncestors({ids, 3}), infos_t{A::info()});
+    EXPECT_EQ(h->commonAncestors({ids, 1}), infos_t{C::info()});
+}
+
+namespace {
+    constexpr myrtti::class_id_t imageLateId{"ImageLate"};
+    const myrtti::ClassInfo imageLate("ImageLate", imageLateId);
+
+    std::string tempPath(const char* name) {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+}
+
+TEST(Hierarchy, Image) {
+
+    with_rtti_root(struct, Base)
+    with_rtti_end();
+
+    with_rtti_vparents(struct, A, (Base))
+    with_rtti_end();
+
+    with_rtti_vparents(struct, B, (Base))
+    with_rtti_end();
+
+    auto* h = myrtti::Hierarchy::instance();
+
+    std::string path = tempPath("myrtti_hierarchy.image");
+    h->saveImage(path);
+
+    auto descendantsBefore = h->descendants(Base::class_id(), true).size();
+
+    ASSERT_TRUE(h->loadImage(path));
+    EXPECT_TRUE(h->isFrozen());
+
+    EXPECT_TRUE(h->isParent(A::class_id(), Base::class_id()));
+    EXPECT_FALSE(h->isParent(Base::class_id(), A::class_id()));
+    EXPECT_EQ(h->getClassInfo(B::class_id()), B::info());
+    EXPECT_EQ(h->descendants(Base::class_id(), true).size(), descendantsBefore);
+    EXPECT_EQ(
+        h->commonAncestors(A::class_id(), B::class_id()),
+        std::vector<const myrtti::ClassInfo*>{Base::info()}
+    );
+
+    // Corrupted images are rejected.
+    std::string brokenPath = tempPath("myrtti_hierarchy_broken.image");
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::ofstream out(brokenPath, std::ios::binary);
+        out.write(content.data(), content.size() / 2);
+    }
+    EXPECT_FALSE(h->loadImage(brokenPath));
+    EXPECT_FALSE(h->loadImage(tempPath("myrtti_hierarchy_missing.image")));
+
+    // Image doesn't match classes registered afterwards.
+    h->add(&imageLate);
+    EXPECT_EQ(h->getClassInfo(imageLateId), &imageLate);
+    EXPECT_FALSE(h->loadImage(path));
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(brokenPath);
+}
+
+TEST(Hierarchy, Remove) {
+
+    with_rtti_root(struct, Base)
+    with_rtti_end();
+
+    auto* h = myrtti::Hierarchy::instance();
+
+    static constexpr myrtti::class_id_t removedRootId{"RemovedRoot"};
+    static constexpr myrtti::class_id_t removedChildId{"RemovedChild"};
+
+    const myrtti::ClassInfo* rootParents[] = {Base::info()};
+    const myrtti::class_id_t rootParentIds[] = {Base::class_id()};
+    myrtti::ClassInfo root("RemovedRoot", removedRootId, rootParentIds, rootParents, 1);
+
+    const myrtti::ClassInfo* childParents[] = {&root};
+    const myrtti::class_id_t childParentIds[] = {removedRootId};
+    myrtti::ClassInfo child("RemovedChild", removedChildId, childParentIds, childParents, 1);
+
+    myrtti::Hierarchy::Module module;
+    {
+        myrtti::Hierarchy::ModuleScope scope(module);
+        h->add(&child);
+    }
+    ASSERT_EQ(module.classes.size(), 2u);
+    EXPECT_EQ(module.classes[0], &root);
+    EXPECT_EQ(module.classes[1], &child);
+
+    EXPECT_TRUE(h->isParent(removedChildId, Base::class_id()));
+    auto descendants = h->descendants(Base::class_id());
+    EXPECT_NE(std::find(begin(descendants), end(descendants), &child), end(descendants));
+
+    // Class can't be removed while its children are registered.
+    EXPECT_THROW(h->remove(&root), std::runtime_error);
+    EXPECT_TRUE(h->isParent(removedChildId, removedRootId));
+
+    uint32_t childIndex = child.getIndex();
+
+    h->remove(module);
+    EXPECT_TRUE(module.classes.empty());
+    EXPECT_FALSE(root.isRegistered());
+    EXPECT_FALSE(child.isRegistered());
+    EXPECT_EQ(h->getClassInfo(removedChildId), nullptr);
+    EXPECT_EQ(h->getClassInfo(removedRootId), nullptr);
+    EXPECT_FALSE(h->isParent(removedChildId, Base::class_id()));
+
+    descendants = h->descendants(Base::class_id());
+    EXPECT_EQ(std::find(begin(descendants), end(descendants), &child), end(descendants));
+    EXPECT_EQ(h->getClassInfo(Base::class_id()), Base::info());
+
+    // Removed classes can be registered again, they get new indices.
+    h->add(&child);
+    EXPECT_TRUE(h->isParent(removedChildId, Base::class_id()));
+    EXPECT_GT(child.getIndex(), childIndex);
+
+    h->remove(&child);
+    h->remove(&root);
+    EXPECT_EQ(h->getClassInfo(removedRootId), nullptr);
+
+    // Hierarchy with removed classes can be rebuilt after freeze.
+    h->freeze();
+    h->add(&root);
+    EXPECT_TRUE(h->isParent(removedRootId, Base::class_id()));
+    h->remove(&root);
+}
+
+TEST(Hierarchy, IncrementalMerge) {
+
+    with_rtti_root(struct, Base)
+    with_rtti_end();
+
+    auto* h = myrtti::Hierarchy::instance();
+
+    // Classes defined at run time, in two batches, each one is merged
+    // into registry tables by query.
+    struct Runtime {
+        const char* name;
+        std::vector<int> parents;
+    };
+    const Runtime defs[] = {
+        {"MergedR", {}},
+        {"MergedA", {0}},
+        {"MergedB", {0}},
+        {"MergedC", {1, 2}},
+        // Second batch.
+        {"MergedD", {3}},
+        {"MergedE", {2}},
+        {"MergedF", {4, 5}},
+    };
+    constexpr std::size_t n = std::size(defs);
+    constexpr std::size_t firstBatch = 4;
+
+    std::vector<myrtti::class_id_t> ids;
+    std::vector<std::vector<myrtti::class_id_t>> parentIds(n);
+    std::vector<std::vector<const myrtti::ClassInfo*>> parentClasses(n);
+    std::vector<std::unique_ptr<myrtti::ClassInfo>> infos;
+    ids.reserve(n);
+
+    for (std::size_t i = 0; i != n; ++i) {
+        ids.emplace_back(defs[i].name);
+        if (defs[i].parents.empty()) {
+            parentIds[i].push_back(Base::class_id());
+            parentClasses[i].push_back(Base::info());
+        }
+        for (int p : defs[i].parents) {
+            parentIds[i].push_back(ids[p]);
+            parentClasses[i].push_back(infos[p].get());
+        }
+        infos.push_back(std::make_unique<myrtti::ClassInfo>(
+            defs[i].name, ids[i],
+            parentIds[i].data(), parentClasses[i].data(), parentIds[i].size()
+        ));
+    }
+
+    // Relations should match linearizations, which are computed
+    // independently from registry tables.
+    auto check = [&](std::size_t registered) {
+        for (std::size_t c = 0; c != registered; ++c) {
+            auto order = myrtti::windup_order(infos[c].get());
+            EXPECT_EQ(h->getClassInfo(ids[c]), infos[c].get());
+            EXPECT_TRUE(h->isParent(ids[c], Base::class_id()));
+            for (std::size_t p = 0; p != registered; ++p) {
+                bool expected = p != c
+                    && std::find(begin(order), end(order), infos[p].get()) != end(order);
+                EXPECT_EQ(h->isParent(ids[c], ids[p]), expected)
+                    << defs[c].name << " : " << defs[p].name;
+            }
+        }
+        EXPECT_EQ(h->descendants(ids[0]).size(), registered - 1);
+    };
+
+    myrtti::Hierarchy::Module module;
+    myrtti::Hierarchy::ModuleScope scope(module);
+
+    for (std::size_t i = 0; i != firstBatch; ++i)
+        h->add(infos[i].get());
+    check(firstBatch);
+
+    for (std::size_t i = firstBatch; i != n; ++i)
+        h->add(infos[i].get());
+    check(n);
+
+    EXPECT_EQ(
+        h->commonAncestors(ids[4], ids[5]),
+        std::vector<const myrtti::ClassInfo*>{infos[2].get()}
+    );
+    EXPECT_EQ(
+        h->commonAncestors(ids[6], ids[3]),
+        std::vector<const myrtti::ClassInfo*>{infos[3].get()}
+    );
+
+    h->remove(module);
+}
+
+TEST(Hierarchy, ClassByName) {
+
+    with_rtti_root(struct, NamedRoot)
+    with_rtti_end();
+
+    with_rtti(struct, NamedFinal, NamedRoot)
+    with_rtti_end();
+
+    // Classes of the same name, defined in different scopes.
+    const myrtti::ClassInfo* twins[2];
+    {
+        with_rtti_root(struct, NamedTwin)
+        with_rtti_end();
+        twins[0] = NamedTwin::info();
+    }
+    {
+        with_rtti(struct, NamedTwin, NamedRoot)
+        with_rtti_end();
+        twins[1] = NamedTwin::info();
+    }
+
+    auto* h = myrtti::Hierarchy::instance();
+
+    // Names known at compile time are hashed during compilation.
+    constexpr myrtti::class_name_t finalName{"NamedFinal"};
+    static_assert(finalName.hash == myrtti::hash_class_name("NamedFinal"));
+
+    EXPECT_EQ(h->getClassInfo(finalName), NamedFinal::info());
+
+    std::string rootName = "NamedRoot";
+    EXPECT_EQ(h->getClassInfo(myrtti::class_name_t(rootName)), NamedRoot::info());
+    EXPECT_EQ(h->getClassInfo(myrtti::class_name_t("NamedUnknown")), nullptr);
+    EXPECT_EQ(h->getClassInfo(myrtti::class_name_t("Named")), nullptr);
+
+    // Ambiguous name doesn't resolve into single class.
+    myrtti::class_name_t twinName{"NamedTwin"};
+    EXPECT_EQ(h->getClassInfo(twinName), nullptr);
+    EXPECT_EQ(
+        h->getClassesByName(twinName),
+        (std::vector<const myrtti::ClassInfo*>{twins[0], twins[1]})
+    );
+    EXPECT_EQ(
+        h->getClassesByName(finalName),
+        std::vector<const myrtti::ClassInfo*>{NamedFinal::info()}
+    );
+    EXPECT_TRUE(h->getClassesByName(myrtti::class_name_t("NamedUnknown")).empty());
+
+    // Runtime class, merged into existing index.
+    const myrtti::ClassInfo* parents[] = {NamedRoot::info()};
+    const myrtti::class_id_t parentIds[] = {NamedRoot::class_id()};
+    myrtti::ClassInfo runtimeTwin(
+        "NamedTwin", myrtti::class_id_t{"NamedTwin", "runtime"}, parentIds, parents, 1
+    );
+    h->add(&runtimeTwin);
+    EXPECT_EQ(
+        h->getClassesByName(twinName),
+        (std::vector<const myrtti::ClassInfo*>{twins[0], twins[1], &runtimeTwin})
+    );
+    h->remove(&runtimeTwin);
+    EXPECT_EQ(h->getClassesByName(twinName).size(), 2u);
+}
+
+TEST(Hierarchy, DefineClass) {
+
+    with_rtti_root(struct, ScriptBase)
+    with_rtti_end();
+
+    with_rtti(struct, ScriptNative, ScriptBase)
+    with_rtti_end();
+
+    auto* h = myrtti::Hierarchy::instance();
+
+    myrtti::Hierarchy::Module module;
+    myrtti::Hierarchy::ModuleScope scope(module);
+
+    const myrtti::ClassInfo* aParents[] = {ScriptBase::info()};
+    const myrtti::ClassInfo* a = h->defineClass("ScriptedA", {aParents, 1});
+
+    const myrtti::ClassInfo* bParents[] = {a, ScriptNative::info()};
+    const myrtti::ClassInfo* b = h->defineClass("ScriptedB", {bParents, 2});
+
+    EXPECT_TRUE(a->isRegistered());
+    EXPECT_STREQ(b->name, "ScriptedB");
+    EXPECT_EQ(b->getId(), myrtti::class_id_t("ScriptedB"));
+    EXPECT_EQ(h->getClassInfo(myrtti::class_id_t("ScriptedA")), a);
+    EXPECT_EQ(h->getClassInfo(myrtti::class_name_t("ScriptedB")), b);
+
+    EXPECT_TRUE(h->isParent(b->getId(), a->getId()));
+    EXPECT_TRUE(h->isParent(b->getId(), ScriptBase::class_id()));
+    EXPECT_TRUE(h->isParent(b->getId(), ScriptNative::class_id()));
+    EXPECT_FALSE(h->isParent(a->getId(), ScriptNative::class_id()));
+
+    auto order = myrtti::windup_order(b);
+    EXPECT_EQ(
+        std::vector<const myrtti::ClassInfo*>(begin(order), end(order)),
+        (std::vector<const myrtti::ClassInfo*>{
+            myrtti::Object::info(), ScriptBase::info(), a, ScriptNative::info(), b
+        })
+    );
+    EXPECT_EQ(
+        h->commonAncestors(b->getId(), ScriptNative::class_id()),
+        std::vector<const myrtti::ClassInfo*>{ScriptNative::info()}
+    );
+
+    // Colliding id is rejected, hierarchy is left intact.
+    EXPECT_THROW(h->defineClass("ScriptedA", {aParents, 1}), std::runtime_error);
+    EXPECT_EQ(h->getClassInfo(a->getId()), a);
+
+    // Chain of classes, defined while readers keep querying hierarchy:
+    // each one is visible as soon as it is defined, and whatever readers
+    // see is consistent.
+    constexpr std::size_t n = 1000;
+    std::vector<std::string> names;
+    std::vector<myrtti::class_id_t> ids;
+    for (std::size_t i = 0; i != n; ++i) {
+        names.push_back("ScriptedChain" + std::to_string(i));
+        ids.emplace_back(names[i].c_str());
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<std::size_t> failures{0};
+
+    auto reader = [&] {
+        while (!done.load(std::memory_order_relaxed)) {
+            for (std::size_t i = 0; i < n; i += 97) {
+                const myrtti::ClassInfo* cls = h->getClassInfo(ids[i]);
+                if (!cls)
+                    break;
+                if (!h->isParent(ids[i], b->getId()) || h->descendants(ids[i]).size() > n)
+                    ++failures;
+            }
+        }
+    };
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i != 2; ++i)
+        readers.emplace_back(reader);
+
+    const myrtti::ClassInfo* last = b;
+    for (std::size_t i = 0; i != n; ++i) {
+        last = h->defineClass(names[i], {&last, 1});
+        if (h->getClassInfo(myrtti::class_name_t(names[i])) != last)
+            ++failures;
+    }
+
+    done = true;
+    for (auto& t : readers)
+        t.join();
+
+    EXPECT_EQ(failures.load(), 0u);
+    EXPECT_EQ(h->descendants(a->getId()).size(), n + 1);
+    EXPECT_EQ(myrtti::unwind_order(last).size(), n + 5);
+
+    // Snapshots replaced by definitions aren't accumulated: once readers
+    // are finished, the next publication reclaims them.
+    auto settled = h->memoryStats().snapshots;
+    h->defineClass("ScriptedChainEnd", {&last, 1});
+    EXPECT_LE(h->memoryStats().snapshots, settled);
+
+    // Removal releases definitions.
+    h->remove(module);
+    EXPECT_EQ(h->getClassInfo(myrtti::class_id_t("ScriptedA")), nullptr);
+    EXPECT_EQ(h->getClassInfo(myrtti::class_name_t("ScriptedChain0")), nullptr);
+    EXPECT_TRUE(h->isParent(ScriptNative::class_id(), ScriptBase::class_id()));
+}
+
+TEST(Hierarchy, MemoryStats) {
+
+    with_rtti_root(struct, Base)
+    with_rtti_end();
+
+    with_rtti(struct, A, Base)
+    with_rtti_end();
+
+    with_rtti(struct, B, Base)
+    with_rtti_end();
+
+    with_rtti_vparents_parents(struct, Final, (B), (A))
+    with_rtti_end();
+
+    auto* h = myrtti::Hierarchy::instance();
+
+    // Defined class brings node based containers back, if hierarchy has
+    // been frozen by other tests.
+    const myrtti::ClassInfo* parents[] = {Final::info()};
+    const myrtti::ClassInfo* defined = h->defineClass("MemoryStatsDefined", {parents, 1});
+    EXPECT_TRUE(h->isParent(defined->getId(), Base::class_id()));
+
+    auto crossPtrsOf = [](
+        const myrtti::Hierarchy::memory_stats_t& stats,
+        const myrtti::ClassInfo* cls
+    ) {
+        auto found = std::find_if(
+            begin(stats.crossPtrs), end(stats.crossPtrs),
+            [&](const auto& entry) { return entry.cls == cls; }
+        );
+        EXPECT_NE(found, end(stats.crossPtrs));
+        return *found;
+    };
+
+    auto before = h->memoryStats();
+    EXPECT_GT(before.idToClass, 0u);
+    EXPECT_GT(before.dag, 0u);
+    EXPECT_GT(before.tables, 0u);
+    EXPECT_GT(before.linearizations, 0u);
+    EXPECT_GE(before.classInfos, sizeof(myrtti::ClassInfo) * before.crossPtrs.size());
+    EXPECT_EQ(before.total(),
+        before.classInfos + before.linearizations + before.idToClass + before.dag
+        + before.tables + before.image + before.snapshots + before.descendants);
+
+    // Object, Base, A, B and Final itself.
+    auto base = crossPtrsOf(before, Base::info());
+    auto final = crossPtrsOf(before, Final::info());
+    EXPECT_EQ(base.entries, 2u);
+    EXPECT_EQ(final.entries, 5u);
+    EXPECT_GT(final.bytes, base.bytes);
+
+    // Descendants are maintained by registration, queries don't
+    // allocate.
+    EXPECT_GT(before.descendants, 0u);
+    EXPECT_FALSE(h->descendants(Base::class_id()).empty());
+    EXPECT_FALSE(h->descendants(Base::class_id(), true).empty());
+    auto cached = h->memoryStats();
+    EXPECT_EQ(cached.total(), before.total());
+
+    h->freeze();
+    auto frozen = h->memoryStats();
+    EXPECT_EQ(frozen.idToClass, 0u);
+    EXPECT_EQ(frozen.dag, 0u);
+    EXPECT_EQ(frozen.tables, cached.tables);
+    EXPECT_LT(frozen.total(), cached.total());
+}
+
+TEST(Hierarchy, MemoryStatsAfterFailedAdd) {
+
+    with_rtti_root(struct, Base)
+    with_rtti_end();
+
+    auto* h = myrtti::Hierarchy::instance();
+    Base::info()->ensureRegistered();
+
+    static constexpr myrtti::class_id_t addedId{"FailedBatchAdded"};
+    const myrtti::ClassInfo* parents[] = {Base::info()};
+    const myrtti::class_id_t parentIds[] = {Base::class_id()};
+    static myrtti::ClassInfo added("FailedBatchAdded", addedId, parentIds, parents, 1);
+    static myrtti::ClassInfo colliding("FailedBatchColliding", Base::class_id());
+
+    // The first class is stored, but batch throws before it is
+    // published, so it stays unregistered until the next registration.
+    myrtti::Hierarchy::Module module;
+    {
+        myrtti::Hierarchy::ModuleScope scope(module);
+        const myrtti::ClassInfo* batch[] = {&added, &colliding};
+        EXPECT_THROW(h->add({batch, 2}), std::runtime_error);
+        EXPECT_FALSE(added.isRegistered());
+
+        auto stats = h->memoryStats();
+        auto found = std::find_if(
+            begin(stats.crossPtrs), end(stats.crossPtrs),
+            [&](const auto& entry) { return entry.cls == &added; }
+        );
+        ASSERT_NE(found, end(stats.crossPtrs));
+        EXPECT_EQ(found->entries, 3u);
+    }
+    ASSERT_EQ(module.classes.size(), 1u);
+    h->remove(module);
+}
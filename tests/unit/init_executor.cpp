@@ -0,0 +1,130 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <myrtti.h>
+#include <myrtti/init_executor.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(InitExecutor, ParentsFirst) {
+
+    with_rtti_root(struct, Base)
+    with_rtti_end();
+
+    with_rtti(struct, A, Base)
+    with_rtti_end();
+
+    with_rtti(struct, B, Base)
+    with_rtti_end();
+
+    with_rtti(struct, A1, A)
+    with_rtti_end();
+
+    with_rtti_vparents_parents(struct, Final, (B), (A1))
+    with_rtti_end();
+
+    std::mutex m;
+    std::vector<const myrtti::ClassInfo*> order;
+    auto record = [&](const myrtti::ClassInfo* cls) {
+        std::lock_guard<std::mutex> guard(m);
+        order.push_back(cls);
+    };
+
+    myrtti::InitExecutor executor(4);
+
+    // Tasks are added in any order, A has no task.
+    executor.add(Final::info(), record);
+    executor.add(A1::info(), record);
+    executor.add(B::info(), record);
+    executor.add(Base::info(), record);
+
+    auto report = executor.run();
+    EXPECT_EQ(report.tasks, 4u);
+    ASSERT_EQ(order.size(), 4u);
+
+    auto position = [&](const myrtti::ClassInfo* cls) {
+        return std::find(begin(order), end(order), cls) - begin(order);
+    };
+    EXPECT_EQ(position(Base::info()), 0);
+    EXPECT_LT(position(A1::info()), position(Final::info()));
+    EXPECT_LT(position(B::info()), position(Final::info()));
+
+    // Base, A1 and Final.
+    EXPECT_EQ(report.criticalPathLength, 3u);
+    EXPECT_LE(report.criticalPath, report.taskTime);
+
+    // Tasks are forgotten once run.
+    order.clear();
+    EXPECT_EQ(executor.run().tasks, 0u);
+    EXPECT_TRUE(order.empty());
+}
+
+TEST(InitExecutor, IndependentBranches) {
+
+    with_rtti_root(struct, Base)
+    with_rtti_end();
+
+    with_rtti(struct, A, Base)
+    with_rtti_end();
+
+    with_rtti(struct, B, Base)
+    with_rtti_end();
+
+    with_rtti(struct, C, Base)
+    with_rtti_end();
+
+    with_rtti(struct, D, Base)
+    with_rtti_end();
+
+    auto sleep = [](const myrtti::ClassInfo*) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    };
+
+    myrtti::InitExecutor executor(4);
+    for (auto* cls : {A::info(), B::info(), C::info(), D::info()})
+        executor.add(cls, sleep);
+
+    // Branches sleep concurrently, even on single core.
+    auto report = executor.run();
+    EXPECT_EQ(report.criticalPathLength, 1u);
+    EXPECT_GE(report.taskTime, std::chrono::milliseconds(200));
+    EXPECT_GT(report.speedup(), 2.0);
+    EXPECT_GT(report.maxSpeedup(), 2.0);
+}
+
+TEST(InitExecutor, TaskThrows) {
+
+    with_rtti_root(struct, Base)
+    with_rtti_end();
+
+    with_rtti(struct, A, Base)
+    with_rtti_end();
+
+    bool derivedRun = false;
+
+    myrtti::InitExecutor executor(2);
+    executor.add(Base::info(), [](const myrtti::ClassInfo*) {
+        throw std::runtime_error("Base");
+    });
+    executor.add(A::info(), [&](const myrtti::ClassInfo*) { derivedRun = true; });
+
+    EXPECT_THROW(executor.run(), std::runtime_error);
+    EXPECT_FALSE(derivedRun);
+}
@@ -0,0 +1,107 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+#include <myrtti.h>
+#include <myrtti/bulk.h>
+#include <myrtti/instance_stats.h>
+
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+    with_rtti_root(struct, Shape)
+        int id = 0;
+    with_rtti_end();
+
+    with_rtti(struct, Circle, Shape)
+        double radius = 1;
+    with_rtti_end();
+
+    with_rtti(struct, Square, Shape)
+        Square() = default;
+        explicit Square(bool fail) {
+            if (fail)
+                throw std::runtime_error("fail");
+        }
+        char side[128] = {};
+    with_rtti_end();
+}
+
+TEST(InstanceStats, Counts) {
+    using myrtti::InstanceStats;
+
+    EXPECT_EQ(Circle::info()->size, sizeof(Circle));
+    EXPECT_EQ(Square::info()->size, sizeof(Square));
+
+    auto shapes0 = InstanceStats::get(Shape::info());
+    auto squares0 = InstanceStats::get(Square::info());
+
+    {
+        std::vector<std::unique_ptr<Shape>> shapes;
+        for (int i = 0; i != 3; ++i)
+            shapes.push_back(std::make_unique<Circle>());
+        for (int i = 0; i != 2; ++i)
+            shapes.push_back(std::make_unique<Square>());
+        shapes.push_back(std::make_unique<Shape>());
+
+        // Objects constructed and destroyed by other thread are counted too.
+        std::unique_ptr<Square> fromThread;
+        std::thread([&] {
+            fromThread = std::make_unique<Square>();
+            auto batch = myrtti::make_many<Circle>(10);
+        }).join();
+
+        auto circles = InstanceStats::get(Circle::info());
+        EXPECT_EQ(circles.instances, 3);
+        EXPECT_EQ(circles.bytes, int64_t(3 * sizeof(Circle)));
+
+        auto squares = InstanceStats::get(Square::info());
+        EXPECT_EQ(squares.instances - squares0.instances, 3);
+
+        auto shapesStats = InstanceStats::get(Shape::info());
+        EXPECT_EQ(shapesStats.instances - shapes0.instances, 1);
+        EXPECT_EQ(shapesStats.totalInstances - shapes0.totalInstances, 7);
+        EXPECT_EQ(
+            shapesStats.totalBytes - shapes0.totalBytes,
+            int64_t(3 * sizeof(Circle) + 3 * sizeof(Square) + sizeof(Shape))
+        );
+
+        // Object rolls up all instances, so it is the biggest one.
+        auto all = InstanceStats::snapshot();
+        ASSERT_FALSE(all.empty());
+        EXPECT_EQ(all[0].cls, myrtti::Object::info());
+        bool squaresFound = false;
+        for (const auto& e : all)
+            squaresFound = squaresFound || e.cls == Square::info();
+        EXPECT_TRUE(squaresFound);
+
+        // Partially constructed objects are not counted.
+        EXPECT_THROW(Square(true), std::runtime_error);
+        EXPECT_EQ(InstanceStats::get(Square::info()).instances, squares.instances);
+        EXPECT_EQ(
+            InstanceStats::get(Shape::info()).totalInstances,
+            shapesStats.totalInstances
+        );
+    }
+
+    EXPECT_EQ(InstanceStats::get(Circle::info()).instances, 0);
+    EXPECT_EQ(
+        InstanceStats::get(Shape::info()).totalInstances,
+        shapes0.totalInstances
+    );
+}
@@ -0,0 +1,127 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <myrtti.h>
+#include <myrtti/hierarchy.h>
+
+#ifdef MYRTTI_TEST_PLUGIN
+
+#include "test_plugin.h"
+
+#include <dlfcn.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+TEST(Module, UnloadUnderConcurrentReaders) {
+
+    with_rtti(struct, HostFinal, PluginBase)
+        int value() const override { return 1; }
+    with_rtti_end();
+
+    auto* h = myrtti::Hierarchy::instance();
+
+    // Ids readers query, plugin ones while plugin is loaded.
+    std::atomic<myrtti::class_id_t> rootId{PluginBase::class_id()};
+    std::atomic<myrtti::class_id_t> finalId{HostFinal::class_id()};
+
+    std::atomic<bool> done{false};
+    std::atomic<bool> failed{false};
+    std::atomic<std::size_t> pluginHits{0};
+
+    auto reader = [&]() {
+        while (!done.load()) {
+            HostFinal f;
+            myrtti::Object* o = &f;
+            if (myrtti::dyn_cast<PluginBase*>(o) != &f)
+                failed = true;
+
+            myrtti::class_id_t root = rootId.load();
+            myrtti::class_id_t final = finalId.load();
+
+            bool derived = h->isParent(final, root);
+
+            // Callback reads plugin memory, it must not be released
+            // while walk is in progress.
+            std::size_t names = 0;
+            h->windup(final, [&](const myrtti::ClassInfo* cls) {
+                names += std::strlen(cls->name);
+                return true;
+            });
+
+            if (derived && names)
+                ++pluginHits;
+        }
+    };
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i != 2; ++i)
+        readers.emplace_back(reader);
+
+    for (int i = 0; i != 20; ++i) {
+        myrtti::Hierarchy::Module module;
+        void* handle;
+        {
+            myrtti::Hierarchy::ModuleScope scope(module);
+            handle = dlopen(MYRTTI_TEST_PLUGIN, RTLD_NOW | RTLD_LOCAL);
+        }
+        ASSERT_NE(handle, nullptr) << dlerror();
+        EXPECT_EQ(module.classes.size(), 2u);
+
+        auto create = reinterpret_cast<plugin_create_t>(dlsym(handle, "myrtti_test_plugin_create"));
+        auto ids = reinterpret_cast<plugin_ids_t>(dlsym(handle, "myrtti_test_plugin_ids"));
+        ASSERT_NE(create, nullptr);
+        ASSERT_NE(ids, nullptr);
+
+        myrtti::class_id_t pluginRoot = PluginBase::class_id();
+        myrtti::class_id_t pluginFinal = PluginBase::class_id();
+        ids(&pluginRoot, &pluginFinal);
+
+        PluginBase* p = create();
+        myrtti::Object* o = p;
+        EXPECT_EQ(myrtti::dyn_cast<PluginBase*>(o), p);
+        EXPECT_EQ(p->value(), 42);
+        EXPECT_TRUE(h->isParent(pluginFinal, PluginBase::class_id()));
+        delete p;
+
+        rootId = pluginRoot;
+        finalId = pluginFinal;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        rootId = PluginBase::class_id();
+        finalId = HostFinal::class_id();
+
+        h->remove(module);
+        EXPECT_EQ(h->getClassInfo(pluginFinal), nullptr);
+        EXPECT_FALSE(h->isParent(pluginFinal, PluginBase::class_id()));
+
+        ASSERT_EQ(dlclose(handle), 0);
+
+        // Library is really unloaded.
+        EXPECT_EQ(dlopen(MYRTTI_TEST_PLUGIN, RTLD_NOW | RTLD_NOLOAD), nullptr);
+    }
+
+    done = true;
+    for (auto& t : readers)
+        t.join();
+
+    EXPECT_FALSE(failed);
+    EXPECT_GT(pluginHits.load(), 0u);
+    EXPECT_EQ(h->getClassInfo(HostFinal::class_id()), HostFinal::info());
+}
+
+#endif
@@ -0,0 +1,105 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <myrtti.h>
+#include <myrtti/hierarchy.h>
+#include <myrtti/object_arena.h>
+
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+TEST(ObjectArena, CreateInstance) {
+
+    with_rtti_root(struct, Shape)
+        virtual int corners() const { return 0; }
+    with_rtti_end();
+
+    with_rtti(struct, Square, Shape)
+        int corners() const override { return 4; }
+        int side = 3;
+    with_rtti_end();
+
+    with_rtti_root(struct, Abstract)
+        virtual void f() = 0;
+    with_rtti_end();
+
+    with_rtti_root(struct, NoDefault)
+        explicit NoDefault(int) {}
+    with_rtti_end();
+
+    struct alignas(64) Aligned : myrtti::RTTI<Aligned> {
+        DEFINE_RTTI(Aligned, myrtti::Object);
+        char data[3];
+    };
+
+    EXPECT_NE(Square::info()->factory, nullptr);
+    EXPECT_EQ(Abstract::info()->factory, nullptr);
+    EXPECT_EQ(NoDefault::info()->factory, nullptr);
+
+    auto* h = myrtti::Hierarchy::instance();
+    myrtti::ObjectArena arena;
+
+    // By id.
+    myrtti::Object* o = h->getClassInfo(Square::class_id())->createInstance(arena);
+    ASSERT_NE(o, nullptr);
+    EXPECT_EQ(o->rtti, Square::info());
+    EXPECT_EQ(myrtti::dyn_cast<Shape*>(o)->corners(), 4);
+    EXPECT_EQ(myrtti::dyn_cast<Square*>(o)->side, 3);
+    EXPECT_EQ(arena.size(), 1u);
+
+    // Released block is reused by the next object of the same class.
+    void* storage = myrtti::dyn_cast<Square*>(o);
+    arena.destroy(o);
+    EXPECT_EQ(arena.size(), 0u);
+
+    // By name.
+    o = h->getClassInfo(myrtti::class_name_t("Square"))->createInstance(arena);
+    ASSERT_NE(o, nullptr);
+    EXPECT_EQ(static_cast<void*>(myrtti::dyn_cast<Square*>(o)), storage);
+    arena.destroy(o);
+
+    EXPECT_EQ(Abstract::info()->createInstance(arena), nullptr);
+    EXPECT_EQ(arena.size(), 0u);
+
+    // Many objects: distinct and aligned storage.
+    std::vector<myrtti::Object*> objects;
+    std::set<void*> blocks;
+    for (int i = 0; i != 1000; ++i) {
+        objects.push_back(Aligned::info()->createInstance(arena));
+        auto* a = myrtti::dyn_cast<Aligned*>(objects.back());
+        ASSERT_NE(a, nullptr);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(a) % 64, 0u);
+        blocks.insert(a);
+    }
+    EXPECT_EQ(blocks.size(), objects.size());
+    EXPECT_EQ(arena.size(), objects.size());
+
+    for (auto* obj : objects)
+        arena.destroy(obj);
+    EXPECT_EQ(arena.size(), 0u);
+}
+
+TEST(ObjectArena, ConstructorThrows) {
+
+    with_rtti_root(struct, Throwing)
+        Throwing() { throw std::runtime_error("throwing"); }
+    with_rtti_end();
+
+    myrtti::ObjectArena arena;
+    EXPECT_THROW(Throwing::info()->createInstance(arena), std::runtime_error);
+    EXPECT_EQ(arena.size(), 0u);
+}
@@ -0,0 +1,58 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <myrtti.h>
+#include <myrtti/hierarchy.h>
+
+#include <cstddef>
+
+namespace {
+    with_rtti_root(struct, EarlyRoot)
+    with_rtti_end();
+
+    with_rtti(struct, EarlyFinal, EarlyRoot)
+    with_rtti_end();
+
+    struct early_t {
+        bool registered;
+        std::size_t windupSize;
+        std::size_t unwindSize;
+        bool isParent;
+    };
+
+    // Runs during static initialization, classes are not necessarily
+    // registered by then: initialization order of translation units
+    // depends on link order.
+    const early_t early = [] {
+        EarlyFinal o;
+        myrtti::Object* obj = &o;
+        return early_t{
+            obj->rtti->isRegistered(),
+            myrtti::windup_order(obj->rtti).size(),
+            myrtti::unwind_order(EarlyFinal::info()).size(),
+            myrtti::Hierarchy::instance()->isParent(
+                EarlyFinal::class_id(), EarlyRoot::class_id()
+            )
+        };
+    }();
+}
+
+TEST(StaticInit, ObjectBeforeRegistration) {
+    // Object, EarlyRoot, EarlyFinal.
+    EXPECT_TRUE(early.registered);
+    EXPECT_EQ(early.windupSize, 3u);
+    EXPECT_EQ(early.unwindSize, 3u);
+    EXPECT_TRUE(early.isParent);
+}
@@ -0,0 +1,33 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Shared library defining classes of its own, see Module tests.
+
+#include "test_plugin.h"
+
+with_rtti(struct, PluginRoot, PluginBase)
+    int value() const override { return 42; }
+with_rtti_end();
+
+with_rtti(struct, PluginFinal, PluginRoot)
+with_rtti_end();
+
+extern "C" PluginBase* myrtti_test_plugin_create() {
+    return new PluginFinal();
+}
+
+extern "C" void myrtti_test_plugin_ids(myrtti::class_id_t* root, myrtti::class_id_t* final) {
+    *root = PluginRoot::class_id();
+    *final = PluginFinal::class_id();
+}
@@ -0,0 +1,34 @@
+// Copyright 2023 Stepan Dyatkovskiy at Kaspersky Lab.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Interface of test plugin, loaded and unloaded by Module tests.
+
+#ifndef MYRTTI_TEST_PLUGIN_H
+#define MYRTTI_TEST_PLUGIN_H
+
+#include <myrtti.h>
+
+with_rtti_root(struct, PluginBase)
+    virtual int value() const = 0;
+with_rtti_end();
+
+extern "C" {
+    /// @brief Creates object of class defined by plugin.
+    using plugin_create_t = PluginBase* (*)();
+
+    /// @brief Returns ids of classes defined by plugin.
+    using plugin_ids_t = void (*)(myrtti::class_id_t* root, myrtti::class_id_t* final);
+}
+
+#endif